@@ -0,0 +1,56 @@
+/*
+ *  This source code is part of MicroPP: a finite element library
+ *  to solve microstructural problems for composite materials.
+ *
+ *  Copyright (C) - 2018 - Guido Giuntoli <gagiuntoli@gmail.com>
+ *						   Jimmy Aguilar Mena <kratsbinovish@gmail.com>
+ *                         Judicaël Grasset <judicael.grasset@stfc.ac.uk>
+ *                         Alejandro Figueroa <afiguer7@maisonlive.gmu.edu>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published
+ *  by the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <cstddef>
+
+/*
+ * Compressed storage of a field <v> next to a reference field <ref> (for
+ * the GP displacements the affine part eps . x, so only the fluctuation
+ * is stored).
+ *
+ * Lossless : the bits of v XOR the bits of ref without their leading zero
+ * bytes, a 4-bit count per value. Values equal to the reference (the
+ * Dirichlet nodes) take half a byte.
+ *
+ * Lossy (tol > 0) : v - ref in steps of tol * max |v - ref|, stored as
+ * zig-zag varints of the difference with the value <stride> positions
+ * before. The error is below half a step.
+ */
+
+typedef struct {
+  int n;          // values, 0 for a zero field
+  int stride;     // distance of the values the lossy steps are taken against
+  double step;    // quantization step, 0 : lossless
+  long size;      // bytes in use
+  long capacity;  // bytes allocated
+  unsigned char *data = NULL;
+
+} cfield;
+
+void cfield_init(cfield *c);
+void cfield_pack(cfield *c, const double *v, const double *ref, const int n, const int stride, const double tol);
+void cfield_unpack(const cfield *c, const double *ref, double *v);
+long cfield_get_bytes(const cfield *c);
+void cfield_free(cfield *c);
@@ -0,0 +1,57 @@
+/*
+ *  This source code is part of MicroPP: a finite element library
+ *  to solve microstructural problems for composite materials.
+ *
+ *  Copyright (C) - 2018 - Guido Giuntoli <gagiuntoli@gmail.com>
+ *                         Jimmy Aguilar Mena <kratsbinovish@gmail.com>
+ *                         Judicaël Grasset <judicael.grasset@stfc.ac.uk>
+ *                         Alejandro Figueroa <afiguer7@maisonlive.gmu.edu>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published
+ *  by the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "ell.hpp"
+
+/*
+ * Sparse Cholesky factor L of a structured <ell_matrix> (A = P^T L L^T P).
+ *
+ * Only the free (interior) degrees of freedom are factorized, the rows
+ * of the Dirichlet nodes are identities (see ell_set_bc_2D/3D) and their
+ * values are copied from the right hand side. The free dofs are ordered
+ * with nested dissection over the structured grid to limit the fill-in.
+ * L is stored by columns (CSC) with the diagonal first on each column.
+ */
+
+#define ND_LEAF_NODES 8  // boxes with fewer nodes are not dissected
+
+typedef struct {
+  int nrow;  // rows of the original matrix
+  int n;     // number of free dofs (size of L)
+  int *dof = NULL;      // dof[k] : row of A of the k-th free dof
+  long int *Lp = NULL;  // column pointers of L (n + 1)
+  int *Li = NULL;       // row indices of L
+  double *Lx = NULL;
+
+} chol_matrix;
+
+int chol_init(chol_matrix *L, const ell_matrix *A);
+void chol_solve(const chol_matrix *L, const double *b, double *x, double *work);  // work : L->n doubles
+void chol_free(chol_matrix *L);
+long int chol_get_nnz(const chol_matrix *L);
+long chol_get_bytes(const chol_matrix *L);
+
+int ell_solve_cg_chol(const ell_matrix *m, ell_solver *s, const chol_matrix *L, const double *b, double *x,
+                      double *err);
@@ -0,0 +1,61 @@
+/*
+ *  This source code is part of MicroPP: a finite element library
+ *  to solve microstructural problems for composite materials.
+ *
+ *  Copyright (C) - 2018 - Guido Giuntoli <gagiuntoli@gmail.com>
+ *						   Jimmy Aguilar Mena <kratsbinovish@gmail.com>
+ *                         Judicaël Grasset <judicael.grasset@stfc.ac.uk>
+ *                         Alejandro Figueroa <afiguer7@maisonlive.gmu.edu>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published
+ *  by the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "ell.hpp"
+
+/*
+ * Deflation space W for the CG of a structured <ell_matrix>.
+ *
+ * The free (interior) nodes of the grid are split in nb x nb x nb boxes
+ * (subdomains) and W has one column per box and field: the indicator of
+ * that field on the nodes of the box. W only depends on the grid so it is
+ * reused by every solve, while A W, W^T A and the coarse matrix E = W^T A W are
+ * refreshed with <defl_update> each time the matrix changes. Removing the
+ * coarse (smooth) error components with W cuts the CG iterations.
+ */
+
+typedef struct {
+  int nrow;
+  int nfield;
+  int ndef;   // columns of W (boxes x nfield)
+  int width;  // boxes coupled with one node through A (4 in 2D, 8 in 3D)
+  int *blk = NULL;         // blk[node] : box of the node, -1 on Dirichlet nodes
+  int *aw_blk = NULL;      // aw_blk[node * width + s] : boxes coupled with the node
+  double *aw_vals = NULL;   // aw_vals[(row * width + s) * nfield + f] : (A W)(row, aw_blk * nfield + f)
+  double *wta_vals = NULL;  // wta_vals[(col * width + s) * nfield + f] : (W^T A)(aw_blk * nfield + f, col)
+  double *E = NULL;         // LU factors of E = W^T A W
+  int *piv = NULL;          // row pivots of the LU factorization
+  double *y = NULL;         // coarse vector (ndef), scratch of the solves
+
+} defl_space;
+
+int defl_init(defl_space *d, const int nfield, const int dim, const int ns[3], const int nb);
+int defl_update(defl_space *d, const ell_matrix *A);
+void defl_free(defl_space *d);
+long defl_get_bytes(const defl_space *d);
+
+/* <y> : coarse scratch (ndef), d->y by default. Threads sharing <d> pass their own. */
+int ell_solve_dcg(const ell_matrix *m, ell_solver *s, const defl_space *d, const double *b, double *x, double *err,
+                  const bool use_x0 = false, double *y = NULL);
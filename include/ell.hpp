@@ -50,28 +50,44 @@ typedef struct {
   int *cols = NULL;
   double *vals = NULL;
 
+} ell_matrix;
+
+/*
+ * Solver state : the CG settings and scratch vectors are kept apart from
+ * the matrix so that one read-only <ell_matrix> (e.g. A0) can be solved
+ * concurrently by several threads, each one with its own <ell_solver>.
+ */
+typedef struct {
+  int nrow;
   int max_its;     // maximun number of iterations
   double min_err;  // minimun error (absolute)
   double rel_err;  // relative error
-  double *k, *r, *z, *p, *Ap;
+  double *k = NULL, *r = NULL, *z = NULL, *p = NULL, *Ap = NULL;
 
-} ell_matrix;
+} ell_solver;
+
+void ell_init(ell_matrix *m, const int nfield, const int dim, const int ns[3]);
 
-void ell_init(ell_matrix *m, const int nfield, const int dim, const int ns[3], const double min_err = CG_ABS_TOL,
-              const double rel_err = CG_REL_TOL, const int max_its = CG_MAX_ITS);
+void ell_solver_init(ell_solver *s, const int nrow, const double min_err = CG_ABS_TOL,
+                     const double rel_err = CG_REL_TOL, const int max_its = CG_MAX_ITS);
+void ell_solver_free(ell_solver *s);
+long ell_solver_get_bytes(const ell_solver *s);
 
 void ell_mvp(const ell_matrix *m, const double *x, double *y);
-int ell_solve_cgpd(const ell_matrix *m, const double *b, double *x, double *err_);
+int ell_solve_cgpd(const ell_matrix *m, ell_solver *s, const double *b, double *x, double *err_,
+                   const bool use_x0 = false);
 void ell_add_2D(ell_matrix *m, int ex, int ey, const double *Ae);
 void ell_add_3D(ell_matrix *m, int ex, int ey, int ez, const double *Ae);
 void ell_set_zero_mat(ell_matrix *m);
 void ell_set_bc_2D(ell_matrix *m);
 void ell_set_bc_3D(ell_matrix *m);
 void ell_free(ell_matrix *m);
+long ell_get_bytes(const ell_matrix *m);
 
 double get_norm(const double *vector, const int n);
 double get_dot(const double *v1, const double *v2, const int n);
 double ell_get_norm(const ell_matrix *m);
+double ell_get_pnorm_0(const ell_solver *s, const double *b, const int n);
 
 int ell_write(string filename, const ell_matrix *A);
 int ell_read(string filename, ell_matrix *A);
@@ -81,7 +97,7 @@ void print_ell(const ell_matrix *A);
 
 void ell_mvp_acc(const ell_matrix *m, const double *x, double *y);
 
-int ell_solve_cgpd_acc(const ell_matrix *m, const double *b, double *x, double *err_);
+int ell_solve_cgpd_acc(const ell_matrix *m, ell_solver *s, const double *b, double *x, double *err_);
 
 double get_norm_acc(const double *vector, const int n);
 
@@ -90,5 +106,5 @@ double get_dot_acc(const double *v1, const double *v2, const int n);
 void print_ell_acc(const ell_matrix *A);
 
 #if defined(_CUDA)
-int ell_solve_cgpd_cuda(const ell_matrix *m, const double *b, double *x, double *err_);
+int ell_solve_cgpd_cuda(const ell_matrix *m, ell_solver *s, const double *b, double *x, double *err_);
 #endif
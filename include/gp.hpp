@@ -25,14 +25,21 @@
 
 #include <cassert>
 #include <cstdlib>
+#include <cstring>
 #include <fstream>
 #include <iostream>
 
+#include "cfield.hpp"
+#include "slab.hpp"
+#include "telemetry.h"
+#include "vars.hpp"
+
 using namespace std;
 
 template <int dim>
 class gp_t {
   static constexpr int nvoi = dim * (dim + 1) / 2;  // 3, 6
+  static constexpr int npe = (dim == 3) ? 8 : 4;
 
  public:
   double strain_old[nvoi] = {0.0};
@@ -42,84 +49,215 @@ class gp_t {
 
   bool allocated;  // flag for memory optimization
 
-  double *vars_n;  // vectors for calculations
-  double *vars_k;
+  vars_map *vars_n;  // internal variables (sparse), nullptr while the GP is linear
+  vars_map *vars_k;
+  vars_map vars_maps[2];  // storage of <vars_n> and <vars_k>
+  slab_t *slab;           // owner of u_n, u_k, the variables and jac (set by micropp)
   double *u_n;
   double *u_k;
-  int nvars;
+  cfield uc_n;  // compressed u_n / u_k, used when u_n / u_k are nullptr
+  cfield uc_k;
+  double strain_uc_n[nvoi];  // strain of the affine part of uc_n / uc_k
+  double strain_uc_k[nvoi];
+  double *jac;  // values of the last jacobian (modified Newton)
+  int nelem;
   int nndim;
 
   long int cost;
   bool converged;
   bool subiterated;
+  int substeps;      // sub-steps accepted in the last homogenization
+  int substep_cuts;  // sub-steps rejected (halved) in the last homogenization
   int coupling;
 
+  int lru_prev;      // previous GP in the LRU list of the resident GPs (spilling), -1 : none
+  int lru_next;      // next GP in that list, -1 : none
+  long spill_bytes;  // bytes of its state when it was last used
+  bool spilled;      // state written back to the spill files
+  bool busy;         // being homogenized
+
+  bool restart_dirty;  // changed since the last restart written
+
+  gp_telemetry telem;  // solver telemetry of the last homogenization
+
   gp_t()
-      : u_n(nullptr),
-        u_k(nullptr),
+      : allocated(false),
         vars_n(nullptr),
         vars_k(nullptr),
-        allocated(false),
+        slab(nullptr),
+        u_n(nullptr),
+        u_k(nullptr),
+        jac(nullptr),
         cost(0),
         converged(true),
-        subiterated(false) {}
+        subiterated(false),
+        substeps(0),
+        substep_cuts(0),
+        lru_prev(-1),
+        lru_next(-1),
+        spill_bytes(0),
+        spilled(false),
+        busy(false),
+        restart_dirty(true) {
+    cfield_init(&uc_n);
+    cfield_init(&uc_k);
+    memset(&telem, 0, sizeof(gp_telemetry));
+  }
 
+  /* The rest of the memory is released with the slab */
   ~gp_t() {
-    if (u_n != nullptr) {
-      free(u_n);
-    }
-    if (u_k != nullptr) {
-      free(u_k);
-    }
-    if (allocated) {
-      free(vars_n);
-      free(vars_k);
-    }
+    cfield_free(&uc_n);
+    cfield_free(&uc_k);
   }
 
   void allocate_u() {
-    u_n = (double *)calloc(nndim, sizeof(double));
-    u_k = (double *)calloc(nndim, sizeof(double));
+    /* Not zeroed here : the owner thread touches it first */
+    u_n = (double *)slab_alloc(slab, nndim * sizeof(double));
+    u_k = (double *)slab_alloc(slab, nndim * sizeof(double));
+    assert(u_n != nullptr && u_k != nullptr);
   }
 
   void allocate() {
     assert(!allocated);
 
-    vars_n = (double *)calloc(nvars, sizeof(double));
-    vars_k = (double *)calloc(nvars, sizeof(double));
+    vars_n = &vars_maps[0];
+    vars_k = &vars_maps[1];
 
-    allocated = (vars_n && vars_k);
+    allocated = (!vars_init(vars_n, nelem, npe, slab) && !vars_init(vars_k, nelem, npe, slab));
     assert(allocated);
   }
 
   void update_vars() {
-    double *tmp = vars_n;
+    vars_map *vars_tmp = vars_n;
     vars_n = vars_k;
-    vars_k = tmp;
+    vars_k = vars_tmp;
 
-    tmp = u_n;
+    double *tmp = u_n;
     u_n = u_k;
     u_k = tmp;
 
+    const cfield uc_tmp = uc_n;
+    uc_n = uc_k;
+    uc_k = uc_tmp;
+    memcpy(strain_uc_n, strain_uc_k, nvoi * sizeof(double));
+
+    /* Same strain, same converged state */
+    if (memcmp(strain_old, strain, nvoi * sizeof(double))) {
+      restart_dirty = true;
+    }
     memcpy(strain_old, strain, nvoi * sizeof(double));
   }
 
-  void write_restart(std::ofstream &file) {
-    file.write((char *)&allocated, sizeof(bool));
+  /*
+   * Restart record : the non-linear flag and strain_old, for the
+   * non-linear GPs also vars_n and u_n (plain or compressed)
+   */
+  long get_restart_bytes() const {
+    long bytes = sizeof(char) + nvoi * sizeof(double);
     if (allocated) {
-      file.write((char *)vars_n, nvars * sizeof(double));
-      file.write((char *)u_n, nndim * sizeof(double));
+      bytes += nelem * sizeof(long) + sizeof(long) + vars_n->size * sizeof(double);
+      if (u_n != nullptr) {
+        bytes += nndim * sizeof(double);
+      } else {
+        bytes += 2 * sizeof(int) + sizeof(double) + sizeof(long) + uc_n.size + nvoi * sizeof(double);
+      }
     }
+    return bytes;
   }
 
-  void read_restart(std::ifstream &file) {
-    file.read((char *)&allocated, sizeof(bool));
+  void pack_restart(char *buf) const {
+    auto put = [&buf](const void *ptr, const size_t bytes) {
+      memcpy(buf, ptr, bytes);
+      buf += bytes;
+    };
+
+    const char flag = allocated;
+    put(&flag, sizeof(char));
+    put(strain_old, nvoi * sizeof(double));
     if (allocated) {
-      vars_n = (double *)calloc(nvars, sizeof(double));
-      vars_k = (double *)calloc(nvars, sizeof(double));
+      put(vars_n->off, nelem * sizeof(long));
+      put(&vars_n->size, sizeof(long));
+      put(vars_n->vals, vars_n->size * sizeof(double));
+      if (u_n != nullptr) {
+        put(u_n, nndim * sizeof(double));
+      } else {
+        put(&uc_n.n, sizeof(int));
+        put(&uc_n.stride, sizeof(int));
+        put(&uc_n.step, sizeof(double));
+        put(&uc_n.size, sizeof(long));
+        put(uc_n.data, uc_n.size);
+        put(strain_uc_n, nvoi * sizeof(double));
+      }
+    }
+  }
+
+  /* Returns 1 if the record does not match its size or <block> (values of the block of each element) */
+  int unpack_restart(const char *buf, const long bytes, const int *block) {
+    const char *end = buf + bytes;
+    bool ok = true;
+    auto get = [&](void *ptr, const long n) {
+      if (!ok || n < 0 || n > end - buf) {
+        ok = false;
+        return;
+      }
+      memcpy(ptr, buf, n);
+      buf += n;
+    };
+
+    char flag;
+    get(&flag, sizeof(char));
+    get(strain_old, nvoi * sizeof(double));
+    if (!ok) {
+      return 1;
+    }
+
+    if (!flag) {
+      /* Back to linear, the old variables stay in the slab unused */
+      allocated = false;
+      vars_n = nullptr;
+      vars_k = nullptr;
+      return (buf == end) ? 0 : 1;
+    }
+
+    if (!allocated) {
+      allocate();
+    }
 
-      file.read((char *)vars_n, nvars * sizeof(double));
-      file.read((char *)u_n, nndim * sizeof(double));
+    long size;
+    get(vars_n->off, nelem * sizeof(long));
+    get(&size, sizeof(long));
+    if (!ok || size < 0 || size > (end - buf) / (long)sizeof(double)) {
+      return 1;
+    }
+    for (int e = 0; e < nelem; ++e) {
+      if (vars_n->off[e] < -1 || vars_n->off[e] > size - block[e]) {
+        vars_clear(vars_n);
+        return 1;
+      }
+    }
+    vars_reserve(vars_n, size);
+    get(vars_n->vals, size * sizeof(double));
+    vars_n->size = size;
+    vars_n->nactive = 0;
+    for (int e = 0; e < nelem; ++e) vars_n->nactive += (vars_n->off[e] >= 0);
+
+    if (u_n != nullptr) {
+      get(u_n, nndim * sizeof(double));
+    } else {
+      cfield_free(&uc_n);
+      get(&uc_n.n, sizeof(int));
+      get(&uc_n.stride, sizeof(int));
+      get(&uc_n.step, sizeof(double));
+      get(&uc_n.size, sizeof(long));
+      if (!ok || uc_n.size < 0 || uc_n.size > end - buf) {
+        cfield_init(&uc_n);
+        return 1;
+      }
+      uc_n.capacity = uc_n.size;
+      uc_n.data = (unsigned char *)malloc(uc_n.size);
+      get(uc_n.data, uc_n.size);
+      get(strain_uc_n, nvoi * sizeof(double));
     }
+    return (ok && buf == end) ? 0 : 1;
   }
 };
@@ -29,51 +29,118 @@
 #define INST_DESTRUCT
 #define INST_START
 #define INST_CUSTOM(strname)
+#define INST_GP(gp)
+#define INST_ITS(its)
+#define INST_TRACE_DUMP(filename)
 
 #else  // For time benchmarks
 
+/*
+ * Each call site gets its region id once (function static), the timings
+ * are accumulated without locks in a table of the calling thread and the
+ * tables are merged by finalize(). Safe inside OpenMP regions.
+ *
+ * With MICROPP_TRACE=<name> in the environment every timing is also
+ * kept in a ring of the thread (the last INST_TRACE_EVENTS) with the GP
+ * and the iterations set by INST_GP / INST_ITS in the region, finalize()
+ * writes them to <name>-<pid>[-<n>].json (Chrome trace, chrome://tracing
+ * or Perfetto). INST_TRACE_DUMP writes them on demand.
+ *
+ * With MICROPP_COUNTERS=1 each thread also opens perf_event counters of
+ * cycles, instructions, LLC misses and, with MICROPP_FP_EVENT=<raw event
+ * in hex> (it is model specific), FP operations. The report gives IPC,
+ * GB/s (LLC misses x 64 B) and GFLOP/s of the regions, "-" for the
+ * counters the kernel or the machine do not give. The counts are scaled
+ * by the time the group was enabled over the time it ran, in case the
+ * kernel multiplexes the counters.
+ */
 #define INST_CONSTRUCT instrument::initialize()
 #define INST_DESTRUCT instrument::finalize()
-#define INST_START instrument __timer__(__FUNCTION__)
-#define INST_CUSTOM(strname) instrument __custom__(strname)
+#define INST_START                                                  \
+  static const int __region__ = instrument::region(__FUNCTION__); \
+  instrument __timer__(__region__)
+#define INST_CUSTOM(strname)                                      \
+  static const int __custom_region__ = instrument::region(strname); \
+  instrument __custom__(__custom_region__)
+#define INST_GP(gp) __timer__.gp_ = (gp)
+#define INST_ITS(its) __timer__.its_ = (its)
+#define INST_TRACE_DUMP(filename) instrument::trace_dump(filename)
 
 #include <atomic>
 #include <chrono>
-#include <stack>
-#include <string>
-#include <unordered_map>
-#include <vector>
-
-#include "util.hpp"
+#include <cstdint>
 
 using namespace std;
 
-typedef vector<uint64_t> timevect;
+#define INST_MAX_REGIONS 256  // the last one takes the regions after it
+#define INST_HIST_BINS 48     // log2 bins of the time in ns
+#define INST_TRACE_EVENTS (64 * 1024)  // events kept per thread by the trace
+
+/* Hardware counters of the regions */
+enum { INST_CYCLES, INST_INSTRUCTIONS, INST_LLC_MISSES, INST_FP_OPS, INST_NCOUNTERS };
+#define INST_NREADS (INST_NCOUNTERS + 2)  // the counters, the time the group was enabled and running
+
+/* Timings of one region in one thread */
+typedef struct {
+  uint64_t count;
+  uint64_t sum;  // ns
+  double sum2;
+  uint64_t min;
+  uint64_t max;
+  uint64_t hist[INST_HIST_BINS];
+  uint64_t counts[INST_NCOUNTERS];
+
+} inst_stats;
+
+/* Timing of the trace */
+typedef struct {
+  uint64_t start;  // ns from initialize()
+  uint64_t dur;
+  int region;
+  int gp;
+  int its;
+
+} inst_event;
 
 class instrument {
  private:
+  const int region_;
   const uint64_t start_time_;
-  const string funct_;
+  uint64_t start_counts_[INST_NREADS];
 
-  static atomic<size_t> instances;               // Counter
-  static uint64_t initialTime;                   // Time collection
-  static unordered_map<string, timevect> times;  // Final register time
+  static atomic<size_t> instances;  // Counter
+  static uint64_t initialTime;      // Time collection
+  static bool counting;             // MICROPP_COUNTERS
+
+  static void read_counters(uint64_t counts[INST_NREADS]);
 
   static inline uint64_t take_time_stamp() {
-    return uint64_t(chrono::high_resolution_clock::now().time_since_epoch().count());
+    return uint64_t(chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now().time_since_epoch()).count());
   }
 
+  static void record(const instrument *inst, const uint64_t elapsed);
+
  public:
-  instrument(const string funct) : funct_(funct), start_time_(take_time_stamp()) {}
+  int gp_;   // GP and iterations of the trace, -1 : none
+  int its_;
 
-  ~instrument() {
-    const uint64_t elapsed = (take_time_stamp() - start_time_) * 1E-3;
-    times[funct_].push_back(elapsed);
+  instrument(const int region) : region_(region), start_time_(take_time_stamp()), gp_(-1), its_(-1) {
+    if (counting) {
+      read_counters(start_counts_);
+    }
   }
 
+  ~instrument() { record(this, take_time_stamp() - start_time_); }
+
+  /* Id of the region <name>, the same for all its call sites */
+  static int region(const char *name);
+
   static void initialize();
 
   static void finalize();
+
+  /* Chrome trace of the events kept, only while no region is timed */
+  static void trace_dump(const char *filename);
 };
 
 #endif  // TIMER
@@ -37,14 +37,28 @@ struct material_t : public material_base {
   CUDA_HOSTDEV
   static material_t *make_material(const struct material_base material);
 
+  /* The materials of make_material() are deleted through material_t */
+  CUDA_HOSTDEV
+  virtual ~material_t() {}
+
   virtual void init_vars(double *vars_old) const = 0;
 
+  /* Internal variables per Gauss point (0 : no history) */
+  virtual int get_nvars() const = 0;
+
   CUDA_HOSTDEV
   virtual void get_stress(const double *eps, double *stress, const double *history_params) const = 0;
 
   CUDA_HOSTDEV
   virtual void get_ctan(const double *eps, double *ctan, const double *history_params) const = 0;
 
+  /*
+   * <stress> and <ctan> in one call, the stress is the base point of the
+   * perturbation for the non-linear materials.
+   */
+  CUDA_HOSTDEV
+  virtual void get_stress_ctan(const double *eps, double *stress, double *ctan, const double *history_params) const;
+
   /*
    * <evolute> function updates <vars_new> using <eps> and
    * <vars_old> returns <false> if the materials remains in
@@ -60,7 +74,8 @@ struct material_t : public material_base {
    * procedure.
    */
   CUDA_HOSTDEV
-  void apply_perturbation(const double *eps, double *ctan, const double *vars_old) const;
+  void apply_perturbation(const double *eps, double *ctan, const double *vars_old,
+                          const double *stress_0 = nullptr) const;
 };
 
 class material_elastic : public material_t {
@@ -79,12 +94,17 @@ class material_elastic : public material_t {
 
   void init_vars(double *vars_old) const;
 
+  int get_nvars() const;
+
   CUDA_HOSTDEV
   void get_stress(const double *eps, double *stress, const double *history_params) const;
 
   CUDA_HOSTDEV
   void get_ctan(const double *eps, double *ctan, const double *history_params) const;
 
+  CUDA_HOSTDEV
+  void get_stress_ctan(const double *eps, double *stress, double *ctan, const double *history_params) const;
+
   bool evolute(const double *eps, const double *vars_old, double *vars_new) const;
 
   void print() const;
@@ -106,6 +126,8 @@ class material_plastic : public material_t {
 
   void init_vars(double *vars_old) const;
 
+  int get_nvars() const;
+
   CUDA_HOSTDEV
   void get_stress(const double *eps, double *stress, const double *history_params) const;
 
@@ -137,6 +159,8 @@ class material_damage : public material_t {
 
   void init_vars(double *vars_old) const;
 
+  int get_nvars() const;
+
   CUDA_HOSTDEV
   void get_stress(const double *eps, double *stress, const double *history_params) const;
 
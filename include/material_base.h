@@ -27,6 +27,9 @@
 enum { MATERIAL_ELASTIC = 0, MATERIAL_PLASTIC, MATERIAL_DAMAGE };
 
 #define D_EPS_CTAN 1.0e-8
+
+#define NUM_VAR_PLASTIC 7  // eps_p (6), alpha (1)
+#define NUM_VAR_DAMAGE 2   // r, D
 #define SQRT_2DIV3 0.816496581
 
 #ifdef __cplusplus
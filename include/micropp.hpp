@@ -23,15 +23,21 @@
 
 #pragma once
 
+#include <atomic>
 #include <cassert>
 #include <cmath>
+#include <condition_variable>
 #include <cstring>
 #include <ctime>
+#include <deque>
 #include <fstream>
 #include <iomanip>
 #include <iostream>
+#include <map>
+#include <mutex>
 #include <sstream>
 #include <string>
+#include <thread>
 #include <vector>
 
 #ifdef _OPENACC
@@ -41,16 +47,44 @@
 #include <omp.h>
 #endif
 
+#include "cholesky.hpp"
+#include "deflation.hpp"
 #include "ell.hpp"
 #include "gp.hpp"
 #include "instrument.hpp"
 #include "material.hpp"
 #include "params.hpp"
+#include "restart.hpp"
+#include "slab.hpp"
+#include "topology.hpp"
 #include "types.hpp"
 #include "util.hpp"
+#include "vars.hpp"
 
 using namespace std;
 
+/* Copy of the state of a GP waiting in the output queue */
+typedef struct {
+  double *u;
+  vars_map vars;  // copy of vars_n
+  bool linear;    // no vars_n
+  std::string filename;
+
+} output_job;
+
+/* Scratch of the homogenization of a GP, kept by each OpenMP thread between the GPs */
+typedef struct {
+  ell_matrix A;  // jacobian
+  double *b;
+  double *du;
+  double *u;
+  double *u_conv;     // start of the sub-step, nullptr without subiterations
+  double *bfgs_s;     // BFGS pairs (s, y), nullptr without nr_bfgs
+  double *bfgs_y;
+  vars_map vars_aux;  // vars_new of the GPs with no history
+
+} gp_work;
+
 template <int tdim>
 class micropp {
  protected:
@@ -66,13 +100,36 @@ class micropp {
   const double vol_tot;
   const double wg, ivol, evol;
 
-  const int micro_type, nvars;
+  const int micro_type;
   const int nsubiterations;
   const bool subiterations;
   const int mpi_rank;
 
   gp_t<tdim> *gp_list;
 
+  /*
+   * Displacements, internal variables and kept jacobians of all the GPs.
+   * The blocks of a GP are first written by the thread that computes it.
+   */
+  slab_t gp_slab;
+
+  /*
+   * NUMA mode : the GPs are split in contiguous blocks, one per node. The
+   * threads of a node take the GPs of its block first (their state was
+   * first touched there) and then steal from the other nodes. A0 and
+   * elem_type are replicated on each node.
+   */
+  const bool numa;
+  topo_t topo;
+  int numa_nodes;
+  int *thread_node;      // node of each OpenMP thread, grown with the solvers
+  int *numa_first;       // GPs of node i : [numa_first[i], numa_first[i + 1])
+  int *numa_next;        // next GP of each block to homogenize
+  ell_matrix *A0_node;   // replicas of A0
+  int **elem_type_node;  // replicas of elem_type
+  long numa_local;       // GPs homogenized by a thread of their node
+  long numa_remote;      // GPs stolen by other nodes
+
   static const int num_geo_params = 4;
   double geo_params[num_geo_params];
 
@@ -95,16 +152,137 @@ class micropp {
 
   const bool lin_stress;
 
-  /* Linear jacobian for optimization */
+  /* Linear jacobian for optimization (shared read-only by all threads) */
   bool use_A0;
   int its_with_A0;
-  ell_matrix *A0;
+  ell_matrix A0;
+
+  /*
+   * Cholesky factor of A0 : direct solver for the iterations with A0
+   * and preconditioner of the CG for the rest of them
+   */
+  bool use_A0_chol;
+  chol_matrix A0_chol;
+
+  /*
+   * CG solver state and scratch vectors and the scratch of the GPs, one
+   * per OpenMP thread, first touched by it. They are grown (grow_solvers)
+   * if the threads are raised after the construction.
+   */
+  int num_solvers;
+  ell_solver *solvers;
+  gp_work *works;  // nullptr without FE GPs
+
+  /*
+   * Deflated CG : A0_defl is built once for A0, <defls> (one per thread)
+   * are refreshed after each assembly of the jacobian
+   */
+  bool use_defl;
+  defl_space A0_defl;
+  defl_space *defls;
+  int defl_blocks;
+
+  /* Initial guess of CG : previous Newton correction scaled */
+  const bool cg_warm_start;
+
+  /*
+   * Inexact Newton : the CG relative tolerance follows the reduction of
+   * the Newton residual (Eisenstat-Walker, choice 2) and never goes below
+   * cg_rel_tol
+   */
+  const bool cg_forcing;
+  const double cg_forcing_max, cg_forcing_gamma, cg_forcing_alpha;
+
+  /*
+   * Linearised predictor : displacement fields of the linear RVE for
+   * unit strains (computed with ctan_lin_fe, nvoi x nndim) that are
+   * combined with the strain increment to start Newton-Raphson
+   */
+  bool use_predictor;
+  double *u_lin;
+
+  /*
+   * Modified Newton : the jacobian is reassembled only when the residual
+   * contracts slower than nr_modified_rate. The jacobians of the first
+   * <jac_keep_max> non-linear FE_ONE_WAY GPs are kept between time steps.
+   * Optionally BFGS pairs of the iterations correct the kept jacobian.
+   */
+  const bool nr_modified;
+  const double nr_modified_rate;
+  const bool nr_bfgs;
+  int jac_keep_max;
+  int jac_kept;
+
+  /*
+   * Out-of-core GP state : with spill_mem the slab is backed by files in
+   * spill_dir. Once the GPs in memory pass the budget the least recently
+   * used ones are written back and dropped (LRU), the GP a thread will
+   * take next is prefetched. The resident GPs that are not being
+   * homogenized form a list (gp_t::lru_prev / lru_next) in order of use,
+   * changed under the spill lock.
+   */
+  long spill_budget;    // bytes, 0 : no spilling
+  int lru_head;         // least recently used GP of the list, -1 : empty
+  int lru_tail;         // most recently used
+  long spill_resident;  // bytes of the GPs in memory
+  long spill_outs;      // GPs written back
+
+  /*
+   * Storage of the GP displacements : plain arrays or the fluctuation
+   * over the affine field eps . x compressed (cfield). The linear GPs can
+   * keep it with a bounded error, it is only the initial guess of Newton.
+   */
+  const int u_storage;
+  const double u_lossy_tol;
 
   /* Rule of Mixture Stuff (for 2 mats micro-structure only) */
   double Vm;  // Volume fraction of Matrix
   double Vf;  // Volume fraction of Fiber
 
+  /* Background writer of the last restart snapshot */
+  std::thread restart_writer;
+
+  /* Delta restarts : chain from the last full restart */
+  const int restart_full_every;
+  std::vector<int> restart_chain;  // restarts of the chain, the full one first
+  long restart_seq;                // sequence number of the last restart written
+  long restart_full_bytes;         // size of the last full restart
+  long restart_delta_bytes;        // size of the deltas after it
+
+  /*
+   * Output queue : output() and output2() copy the state of the GP and
+   * return, the workers compute the fields and write the files. The
+   * .vtm of the time steps of output2() are written by output_flush(),
+   * which then drops their lists : the files of a time step go in one
+   * flush.
+   */
+  std::vector<std::thread> output_workers;
+  std::deque<output_job> output_queue;
+  std::mutex output_mutex;
+  std::condition_variable output_cv;       // new job or stop
+  std::condition_variable output_done_cv;  // job taken or written
+  int output_busy;                         // jobs being written
+  bool output_stop;
+  const bool output_vtm;
+  std::map<int, std::vector<int>> output_steps;  // elem_global of the files of the steps after the last .vtm
+
+  /* Telemetry log : one record per GP and homogenization */
+  const int telemetry_log;
+  int telemetry_id = 0;
+  ofstream ofstream_telem;
+
+  /*
+   * Memory accounting by category (MEM_*) : the GP state is refreshed
+   * after each homogenization, the temporaries of the homogenizations and
+   * of the output are counted while they exist.
+   */
+  mutable std::atomic<long> mem_current[MEM_NCATS];
+  mutable std::atomic<long> mem_peak[MEM_NCATS];
+  mutable std::atomic<long> mem_peak_total;
+
   /* IO files */
+  const int vtu_format;
+  const bool vti_output;
   const bool write_log_flag;
   int log_id = 0;
   ofstream ofstream_log;
@@ -124,50 +302,122 @@ class micropp {
    */
   void homogenize_linear(gp_t<tdim> *gp_ptr);
 
+  void homogenize_gp(gp_t<tdim> *gp_ptr);
+
   /* FE-based homogenizations */
   void homogenize_fe_one_way(gp_t<tdim> *gp_ptr);
   void homogenize_fe_full(gp_t<tdim> *gp_ptr);
 
   void calc_ctan_lin_fe_models();
+  void calc_displ_predictor(const double strain_old[nvoi], const double strain[nvoi], double *u) const;
+  void calc_displ_affine(const double strain[nvoi], double *u) const;
+  void load_u(const gp_t<tdim> *gp_ptr, double *u, double *work, const bool last = false) const;
+  void store_u(gp_t<tdim> *gp_ptr, const double *u, double *work);
   void calc_ctan_lin_mix_rule_Chamis(double ctan[nvoi * nvoi]);
 
   material_t *get_material(const int e) const;
 
-  void get_stress(int gp, const double eps[nvoi], const double *vars_old, double stress_gp[nvoi], int ex, int ey,
+  int get_thread_node() const;
+  const ell_matrix *get_A0() const;
+  const int *get_elem_type() const;
+  void numa_init();
+  void numa_threads(const int nthreads);
+  void numa_replicate();
+  void grow_solvers();
+  void works_init(const int first);
+  gp_work *get_work();
+  int numa_take_gp(const int node);
+
+  void get_stress(int gp, const double eps[nvoi], const vars_map *vars_old, double stress_gp[nvoi], int ex, int ey,
                   int ez = 0) const;
 
   int get_elem_type(int ex, int ey, int ez = 0) const;
 
-  void get_elem_rhs(const double *u, const double *vars_old, double be[npe * dim], int ex, int ey, int ez = 0) const;
+  /* <stress_e> (if given) is the sum of the Gauss point stresses times their weights */
+  void get_elem_rhs(const double *u, const vars_map *vars_old, double be[npe * dim], int ex, int ey, int ez = 0,
+                    double *stress_e = nullptr) const;
+
+  void get_elem_rhs_mat(const double *u, const vars_map *vars_old, double be[npe * dim],
+                        double Ae[npe * dim * npe * dim], int ex, int ey, int ez = 0, double *stress_e = nullptr) const;
 
-  void calc_ave_stress(const double *u, double stress_ave[nvoi], const double *vars_old = nullptr) const;
+  void calc_ave_stress(const double *u, double stress_ave[nvoi], const vars_map *vars_old = nullptr) const;
 
   void calc_ave_strain(const double *u, double strain_ave[nvoi]) const;
 
-  void calc_fields(double *u, double *vars_old);
+  void calc_fields(const double *u, const vars_map *vars_old, double *strain_e, double *stress_e) const;
 
   void calc_bmat(int gp, double bmat[nvoi][npe * dim]) const;
 
   void calc_volume_fractions();
 
-  bool calc_vars_new(const double *u, const double *vars_old, double *vars_new) const;
+  bool calc_vars_new(const double *u, const vars_map *vars_old, vars_map *vars_new) const;
 
+  /*
+   * <inexact> enables the CG forcing terms and the modified Newton (if
+   * cg_forcing / nr_modified are set). The finite difference tangents and
+   * the FE_FULL solutions they start from keep the full CG tolerance and
+   * the full Newton-Raphson.
+   */
   newton_t newton_raphson(ell_matrix *A, double *b, double *u, double *du, const double strain[nvoi],
-                          const double *vars_old = nullptr);
+                          const vars_map *vars_old = nullptr, const bool inexact = false, const bool reuse_A = false,
+                          gp_telemetry *telem = nullptr);
+
+  newton_t newton_substepping(gp_t<tdim> *gp_ptr, ell_matrix *A, double *b, double *u, double *du,
+                              const bool inexact);
+
+  bool load_jacobian(const gp_t<tdim> *gp_ptr, ell_matrix *A) const;
+
+  void keep_jacobian(gp_t<tdim> *gp_ptr, const ell_matrix *A);
 
-  void get_elem_mat(const double *u, const double *vars_old, double Ae[npe * dim * npe * dim], int ex, int ey,
+  long get_gp_bytes(const gp_t<tdim> *gp_ptr) const;
+
+  void spill_gp(gp_t<tdim> *gp_ptr, const bool prefetch);
+
+  void lru_remove(const int igp);
+
+  void lru_append(const int igp);
+
+  void spill_begin(const int igp);
+
+  void spill_end(const int igp);
+
+  const char *restart_map(const int restart_id, long *bytes) const;
+
+  void get_elem_mat(const double *u, const vars_map *vars_old, double Ae[npe * dim * npe * dim], int ex, int ey,
                     int ez = 0) const;
 
   void set_displ_bc(const double strain[nvoi], double *u);
 
-  double assembly_rhs(const double *u, const double *vars_old, double *b);
+  /*
+   * The residual assemblies also give the average stress <stress_ave> (if
+   * given) of the stresses they evaluate, equal to calc_ave_stress
+   */
+  double assembly_rhs(const double *u, const vars_map *vars_old, double *b, double *stress_ave = nullptr);
+
+  double set_rhs_bc(double *b) const;
 
-  void assembly_mat(ell_matrix *A, const double *u, const double *vars_old);
+  double assembly_rhs_mat(ell_matrix *A, const double *u, const vars_map *vars_old, double *b,
+                          double *stress_ave = nullptr);
 
-  void write_vtu(double *u, double *vars_old, const char *filename);
+  void assembly_mat(ell_matrix *A, const double *u, const vars_map *vars_old);
+
+  void write_vtu(const double *u, const vars_map *vars_old, const double *strain_e, const double *stress_e,
+                 const char *filename) const;
+
+  void output_push(const int gp_id, const char *filename);
+
+  void output_worker();
+
+  void write_vtm(const int time_step) const;
 
   void write_log();
 
+  void write_telemetry();
+
+  void mem_add(const int cat, const long bytes) const;
+
+  void mem_update_gp_state() const;
+
 #ifdef _CUDA
   void cuda_init(const micropp_params_t &params);
   void cuda_finalize();
@@ -204,15 +454,50 @@ class micropp {
 
   bool has_subiterated(int gp_id) const;
 
+  int get_substeps(int gp_id) const;
+
+  int get_substep_cuts(int gp_id) const;
+
+  /* Telemetry of the last homogenization of the GP (see telemetry.h) */
+  const gp_telemetry *get_telemetry(int gp_id) const;
+
+  void get_numa_counts(long *local, long *remote) const;
+
+  /*
+   * Pre-flight estimate of the peak memory and of the flops of one
+   * homogenize() for <params> with <nthreads> OpenMP threads. It is an
+   * upper bound : all the FE GPs non-linear with internal variables in
+   * every element, nr_max_its Newton iterations per solve and a full
+   * restart snapshot on the way.
+   */
+  static micropp_resources_t estimate_resources(const micropp_params_t &params, const int nthreads);
+
+  /* Bytes in use and their peak since the construction */
+  micropp_memory_t get_memory_usage() const;
+
   void output(int gp_id, const char *filename);
 
   void output2(const int gp_id, const int elem_global, const int time_step);
 
+  /* Waits for the output queue */
+  void output_flush();
+
   void update_vars();
 
-  void write_restart(const int restart_id) const;
+  /*
+   * The restart is written from a snapshot by a background thread while
+   * the computation goes on, restart_wait() returns when it is on disk.
+   * With restart_full_every > 1 only one of <n> restarts is full, the
+   * others have the GPs changed since the previous one and need it to be
+   * read. read_restart waits for the restart being written and returns 1
+   * if a file of the chain is missing, does not match this micropp or has
+   * a corrupted record.
+   */
+  void write_restart(const int restart_id);
+
+  void restart_wait();
 
-  void read_restart(const int restart_id) const;
+  int read_restart(const int restart_id);
 
   void print_info() const;
 };
@@ -25,6 +25,7 @@
 #define MICROPP3_WRAPPER_H
 
 #include "material_base.h"
+#include "telemetry.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -60,14 +61,21 @@ bool micropp3_has_converged(const struct micropp3 *self, int gp_id);
 
 bool micropp3_has_subiterated(const struct micropp3 *self, int gp_id);
 
+int micropp3_get_substeps(const struct micropp3 *self, int gp_id);
+
+int micropp3_get_substep_cuts(const struct micropp3 *self, int gp_id);
+
+void micropp3_get_telemetry(const struct micropp3 *self, int gp_id, struct gp_telemetry *telem);
+
 void micropp3_output(struct micropp3 *self, const int gp_id, const char *filename);
+void micropp3_output_flush(struct micropp3 *self);
 
 void micropp3_print_info(struct micropp3 *self);
 
 int micropp3_get_non_linear_gps(const struct micropp3 *self);
 
 void micropp3_write_restart(const struct micropp3 *self, const int restart_id);
-void micropp3_read_restart(const struct micropp3 *self, const int restart_id);
+int micropp3_read_restart(const struct micropp3 *self, const int restart_id);  // 1 : the GPs were not restored
 
 #ifdef __cplusplus
 }
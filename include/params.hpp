@@ -24,7 +24,7 @@
 #pragma once
 
 #define MAX_DIM 3
-#define NUM_VAR_GP 7  // eps_p_1 (6) , alpha_1 (1)
+#define NUM_VAR_GP 7  // max. internal variables of a Gauss point (plastic : eps_p_1 (6) , alpha_1 (1))
 #define MAX_MATERIALS 3
 
 #define FILTER_REL_TOL 1.0e-5
@@ -36,6 +36,19 @@
 #define NR_MAX_TOL 1.0e-10
 #define NR_MAX_ITS 4
 #define NR_REL_TOL 1.0e-3  // factor against first residual
+#define NR_MAX_BFGS_PAIRS 8
+
+#define SUBSTEP_EASY_ITS 1     // sub-steps converged in these Newton its double the next one
+#define SUBSTEP_MAX_CUTS 4     // halvings of the sub-increment allowed in one homogenization
+#define SUBSTEP_T_TOL 1.0e-12  // sub-steps ending closer than this to the end of the step end on it
+
+#define GP_SLAB_CHUNK (32 * 1024 * 1024)  // bytes of the chunks of the GP slab
+
+#define VTU_BLOCK (1024 * 1024)  // bytes of the compressed blocks and of the buffer of the VTU files
+#define OUTPUT_QUEUE_JOBS 4      // outputs waiting per worker before output() blocks
+
+#define EST_CG_ITS 10      // CG iterations of a solve per node of the longest side (estimate_resources)
+#define EST_CHOL_FILL 3.5  // nnz of the Cholesky factor / n^1.5 for n free dofs (estimate_resources)
 
 #define glo_elem(ex, ey, ez) ((ez) * (nx - 1) * (ny - 1) + (ey) * (nx - 1) + (ex))
 #define intvar_ix(e, gp, var) ((e) * npe * NUM_VAR_GP + (gp) * NUM_VAR_GP + (var))
@@ -0,0 +1,75 @@
+/*
+ *  This source code is part of MicroPP: a finite element library
+ *  to solve microstructural problems for composite materials.
+ *
+ *  Copyright (C) - 2018 - Guido Giuntoli <gagiuntoli@gmail.com>
+ *						   Jimmy Aguilar Mena <kratsbinovish@gmail.com>
+ *                         Judicaël Grasset <judicael.grasset@stfc.ac.uk>
+ *                         Alejandro Figueroa <afiguer7@maisonlive.gmu.edu>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published
+ *  by the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+/*
+ * Restart file : micropp-restart-<mpi_rank>-<#restart>.bin
+ *
+ *   restart_header
+ *   restart_entry[nrec]   (one per GP record)
+ *   records               (gp_t::pack_restart)
+ *
+ * The offsets of the entries are from the start of the file and each
+ * record has its CRC-32, so the records can be checked and read in
+ * parallel from a mapping of the file.
+ *
+ * A delta restart has the records of the GPs changed since restart
+ * <prev> only, it is read by replaying the full restart at the start of
+ * the chain and the deltas after it. The sequence numbers of the files
+ * strictly decrease along the chain, a file of it overwritten later by
+ * another restart breaks the chain instead of mixing states.
+ */
+
+#define RESTART_MAGIC "MICROPP"
+#define RESTART_VERSION 3
+#define RESTART_MAX_CHAIN 1024
+
+typedef struct {
+  char magic[8];
+  int version;
+  int dim;
+  int size[3];
+  int ngp;
+  int nrec;       // records in the file
+  int u_storage;  // format of the displacements in the records
+  int prev;       // restart this one is a delta of, -1 : full restart
+  int reserved;   // keeps the size a multiple of 8 (the entries follow)
+  long seq;       // sequence number, increases with each restart written
+
+} restart_header;
+
+static_assert(sizeof(restart_header) % 8 == 0, "restart_entry table misaligned");
+
+typedef struct {
+  int gp;
+  uint32_t crc;
+  long offset;
+  long bytes;
+
+} restart_entry;
+
+uint32_t restart_crc32(const void *data, const size_t bytes);
@@ -0,0 +1,65 @@
+/*
+ *  This source code is part of MicroPP: a finite element library
+ *  to solve microstructural problems for composite materials.
+ *
+ *  Copyright (C) - 2018 - Guido Giuntoli <gagiuntoli@gmail.com>
+ *						   Jimmy Aguilar Mena <kratsbinovish@gmail.com>
+ *                         Judicaël Grasset <judicael.grasset@stfc.ac.uk>
+ *                         Alejandro Figueroa <afiguer7@maisonlive.gmu.edu>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published
+ *  by the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <cstddef>
+
+/*
+ * Slab (arena) of the Gauss point state.
+ *
+ * The memory is taken from the system in large chunks and handed out by
+ * bumping an offset, aligned to SLAB_ALIGN. The blocks are never released
+ * one by one : the whole slab is freed at once. <slab_alloc> can be called
+ * from inside a parallel region and it does not touch the memory, so the
+ * pages are placed by the first thread that writes them.
+ *
+ * With a <dir> the chunks are shared mappings of (unlinked) files in it,
+ * so the kernel can write them back instead of running out of memory and
+ * <slab_evict> / <slab_prefetch> move blocks to and from the disk. Without
+ * it both do nothing.
+ */
+
+#define SLAB_ALIGN 64
+
+typedef struct {
+  size_t chunk_size;  // minimum bytes of a new chunk
+  int nchunks;
+  int max_chunks;  // length of <chunks> and <sizes>
+  char **chunks = NULL;
+  size_t *sizes = NULL;  // bytes of each chunk
+  int *fds = NULL;       // files of the chunks, -1 on the heap
+  char *dir = NULL;      // directory of the files, NULL for the heap
+  size_t used;           // bytes handed out of the last chunk
+  size_t bytes;          // bytes of all the chunks
+  size_t bytes_used;     // bytes handed out
+
+} slab_t;
+
+int slab_init(slab_t *s, const size_t chunk_size, const char *dir = NULL);
+void *slab_alloc(slab_t *s, const size_t bytes);
+void slab_evict(slab_t *s, const void *ptr, const size_t bytes);
+void slab_prefetch(slab_t *s, const void *ptr, const size_t bytes);
+size_t slab_get_bytes(const slab_t *s);
+size_t slab_get_used(const slab_t *s);
+void slab_free(slab_t *s);
@@ -0,0 +1,65 @@
+/*
+ *  This source code is part of MicroPP: a finite element library
+ *  to solve microstructural problems for composite materials.
+ *
+ *  Copyright (C) - 2018 - Guido Giuntoli <gagiuntoli@gmail.com>
+ *                         Jimmy Aguilar Mena <kratsbinovish@gmail.com>
+ *                         Judicaël Grasset <judicael.grasset@stfc.ac.uk>
+ *                         Alejandro Figueroa <afiguer7@maisonlive.gmu.edu>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published
+ *  by the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#define TELEM_MAX_ITS 32  // Newton residuals and CG solves kept per homogenization
+
+/* Format of the telemetry log (micropp-telemetry-<mpi_rank>.csv / .bin) */
+enum { TELEM_LOG_NONE, TELEM_LOG_CSV, TELEM_LOG_BINARY };
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Solver telemetry of the last homogenization of a GP (all its Newton
+ * solves : sub-steps and tangent included). The assembly time includes
+ * the stresses of the material laws, the material time is the update of
+ * the internal variables.
+ *
+ * If you change this remember to change also the gp_telemetry Fortran
+ * type (micropp.f95)
+ */
+struct gp_telemetry {
+  double t_total;  // s
+  double t_assembly;
+  double t_solve;
+  double t_material;
+  double residuals[TELEM_MAX_ITS];  // Newton residual norms, the initial one of each solve included
+  long long bytes;                  // memory of the GP state
+  int newton_its;
+  int solver_its;
+  int nsolves;                      // linear solves
+  int solve_its[TELEM_MAX_ITS];     // CG iterations of the first TELEM_MAX_ITS solves
+  int nresiduals;                   // residuals kept
+  int substeps;
+  int substep_cuts;
+  int converged;
+};
+
+#ifdef __cplusplus
+}
+#endif
+#endif
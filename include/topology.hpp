@@ -0,0 +1,45 @@
+/*
+ *  This source code is part of MicroPP: a finite element library
+ *  to solve microstructural problems for composite materials.
+ *
+ *  Copyright (C) - 2018 - Guido Giuntoli <gagiuntoli@gmail.com>
+ *						   Jimmy Aguilar Mena <kratsbinovish@gmail.com>
+ *                         Judicaël Grasset <judicael.grasset@stfc.ac.uk>
+ *                         Alejandro Figueroa <afiguer7@maisonlive.gmu.edu>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published
+ *  by the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <cstddef>
+
+/*
+ * NUMA topology of the node read from /sys/devices/system/node.
+ *
+ * Without that information (other systems, containers) everything is
+ * one node. The node of a thread is the node of the CPU it runs on, so it
+ * is only stable when the threads are bound (OMP_PROC_BIND).
+ */
+
+typedef struct {
+  int nnodes;
+  int ncpus;             // length of <cpu_node>
+  int *cpu_node = NULL;  // cpu_node[cpu] : node of the CPU
+
+} topo_t;
+
+int topo_init(topo_t *t);
+int topo_get_node(const topo_t *t);
+void topo_free(topo_t *t);
@@ -26,11 +26,15 @@
 #include <iostream>
 #include <map>
 
+#include "telemetry.h"
+
 typedef struct {
   /* Results from newton-raphson loop */
   int its = 0;
   int solver_its = 0;
   bool converged = false;
+  bool assembled = false;  // <A> holds the jacobian of the last iteration
+  double stress[6];        // average stress of the last residual (at the returned <u>)
 
   void print() {
     cout << "newton.its        : " << its << endl;
@@ -40,6 +44,12 @@ typedef struct {
 
 } newton_t;
 
+/* Storage of the GP displacements */
+enum { U_PLAIN, U_LOSSLESS, U_LOSSY };
+
+/* Format of the VTU files (VTU_ZLIB falls back to VTU_RAW without zlib) */
+enum { VTU_ASCII, VTU_RAW, VTU_ZLIB };
+
 typedef struct {
   int ngp = 1;
   int size[3];
@@ -56,11 +66,34 @@ typedef struct {
   int cg_max_its = CG_MAX_ITS;
   double cg_abs_tol = CG_ABS_TOL;
   double cg_rel_tol = CG_REL_TOL;
+  int cg_defl_blocks = 0;  // boxes per direction of the CG deflation space (0 : plain CG)
+  bool cg_warm_start = false;  // CG starts from the previous Newton correction
+  bool cg_forcing = false;       // Eisenstat-Walker CG tolerance (inexact Newton)
+  double cg_forcing_max = 1.0e-2;
+  double cg_forcing_gamma = 0.9;
+  double cg_forcing_alpha = 2.0;
+  bool nr_modified = false;        // modified Newton : the jacobian is kept while the residual contracts
+  double nr_modified_rate = 0.25;  // the jacobian is reassembled when norm / norm_prev is above it
+  int nr_jac_mem = 0;              // MB for the jacobians kept between time steps (modified Newton)
+  bool nr_bfgs = false;            // BFGS corrections of the kept jacobian (modified Newton)
   bool calc_ctan_lin = true;
   bool use_A0 = false;
   int its_with_A0 = 1;
+  bool use_A0_chol = false;
+  bool use_predictor = false;  // Newton starts from u_n + unit-strain fields x strain increment
   bool lin_stress = true;
   bool write_log = false;
+  bool numa = false;  // GPs owned by NUMA nodes, per node replicas of A0 and elem_type
+  int u_storage = U_PLAIN;      // u_n / u_k as plain arrays or compressed fluctuations (U_LOSSY : linear GPs only)
+  double u_lossy_tol = 1.0e-6;  // U_LOSSY error bound relative to the largest fluctuation
+  int spill_mem = 0;               // MB of GP state in memory, the rest in files of spill_dir (0 : no spilling)
+  const char *spill_dir = ".";     // local scratch for spill_mem, not a tmpfs as /tmp often is
+  int restart_full_every = 1;      // full restart every <n> write_restart, deltas of the last one in between
+  int vtu_format = VTU_RAW;        // binary appended data, VTU_ASCII for debugging
+  bool vti_output = false;         // output as ImageData (.vti), no points and cells
+  int output_threads = 0;          // background writers of output / output2 (0 : written before returning)
+  bool output_vtm = false;         // .vtm index of the files of output2 of each time step
+  int telemetry_log = TELEM_LOG_NONE;  // GP telemetry of every homogenization to micropp-telemetry-<mpi_rank>.*
 
   void print() {
     cout << "ngp  : " << ngp << endl;
@@ -73,15 +106,79 @@ typedef struct {
     cout << "nr_max_its : " << nr_max_its << endl;
     cout << "nr_max_tol : " << nr_max_tol << endl;
     cout << "nr_rel_tol : " << nr_rel_tol << endl;
+    cout << "cg_defl_blocks : " << cg_defl_blocks << endl;
+    cout << "cg_warm_start : " << cg_warm_start << endl;
+    cout << "cg_forcing : " << cg_forcing << endl;
+    cout << "cg_forcing_max : " << cg_forcing_max << endl;
+    cout << "cg_forcing_gamma : " << cg_forcing_gamma << endl;
+    cout << "cg_forcing_alpha : " << cg_forcing_alpha << endl;
+    cout << "nr_modified : " << nr_modified << endl;
+    cout << "nr_modified_rate : " << nr_modified_rate << endl;
+    cout << "nr_jac_mem : " << nr_jac_mem << endl;
+    cout << "nr_bfgs : " << nr_bfgs << endl;
     cout << "calc_ctan_lin : " << calc_ctan_lin << endl;
     cout << "use_A0 : " << use_A0 << endl;
     cout << "its_with_A0 : " << its_with_A0 << endl;
+    cout << "use_A0_chol : " << use_A0_chol << endl;
+    cout << "use_predictor : " << use_predictor << endl;
     cout << "lin_stress : " << lin_stress << endl;
     cout << "write_log : " << write_log << endl;
+    cout << "numa : " << numa << endl;
+    cout << "u_storage : " << u_storage << endl;
+    cout << "u_lossy_tol : " << u_lossy_tol << endl;
+    cout << "spill_mem : " << spill_mem << endl;
+    cout << "spill_dir : " << spill_dir << endl;
+    cout << "restart_full_every : " << restart_full_every << endl;
+    cout << "vtu_format : " << vtu_format << endl;
+    cout << "vti_output : " << vti_output << endl;
+    cout << "output_threads : " << output_threads << endl;
+    cout << "output_vtm : " << output_vtm << endl;
+    cout << "telemetry_log : " << telemetry_log << endl;
   }
 
 } micropp_params_t;
 
+/* Categories of the memory accounting */
+enum { MEM_GP_STATE, MEM_MATRICES, MEM_WORKSPACES, MEM_OUTPUT, MEM_NCATS };
+
+static const char *const mem_names[MEM_NCATS] = {"gp_state", "matrices", "workspaces", "output"};
+
+typedef struct {
+  /* Pre-flight estimate of micropp::estimate_resources */
+  long bytes[MEM_NCATS];  // peak by category
+  long bytes_total;
+  double flops_assembly;  // residual and jacobian of one RVE
+  double flops_cg_it;     // one CG iteration
+  double flops_step;      // one homogenize() of all the GPs
+
+  void print() const {
+    for (int c = 0; c < MEM_NCATS; ++c) {
+      cout << "estimate." << mem_names[c] << " [MB] : " << bytes[c] / (1024.0 * 1024.0) << endl;
+    }
+    cout << "estimate.total [MB] : " << bytes_total / (1024.0 * 1024.0) << endl;
+    cout << "estimate.flops_step : " << flops_step << endl;
+  }
+
+} micropp_resources_t;
+
+typedef struct {
+  /* Live memory of micropp::get_memory_usage */
+  long current[MEM_NCATS];
+  long peak[MEM_NCATS];
+  long current_total;
+  long peak_total;
+
+  void print() const {
+    for (int c = 0; c < MEM_NCATS; ++c) {
+      cout << "memory." << mem_names[c] << " [MB] : " << current[c] / (1024.0 * 1024.0) << " (peak "
+           << peak[c] / (1024.0 * 1024.0) << ")" << endl;
+    }
+    cout << "memory.total [MB] : " << current_total / (1024.0 * 1024.0) << " (peak " << peak_total / (1024.0 * 1024.0)
+         << ")" << endl;
+  }
+
+} micropp_memory_t;
+
 enum {
   MIC_HOMOGENEOUS,
   MIC_SPHERE,
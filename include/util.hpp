@@ -44,6 +44,7 @@
  */
 
 #include <cassert>
+#include <chrono>
 #include <cmath>
 #include <cstdint>
 #include <cstring>
@@ -65,6 +66,9 @@ inline uint64_t devest(const vector<uint64_t> &in, const uint64_t mean) {
   return sqrt(out / in.size());
 }
 
+/* Seconds of a monotonic clock */
+inline double wall_time() { return chrono::duration<double>(chrono::steady_clock::now().time_since_epoch()).count(); }
+
 constexpr int mypow(int v, int e) { return (e == 0) ? 1 : v * mypow(v, e - 1); }
 
 inline void print_vec(const double *vec, int n, const char file_name[]) {
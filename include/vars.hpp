@@ -0,0 +1,64 @@
+/*
+ *  This source code is part of MicroPP: a finite element library
+ *  to solve microstructural problems for composite materials.
+ *
+ *  Copyright (C) - 2018 - Guido Giuntoli <gagiuntoli@gmail.com>
+ *						   Jimmy Aguilar Mena <kratsbinovish@gmail.com>
+ *                         Judicaël Grasset <judicael.grasset@stfc.ac.uk>
+ *                         Alejandro Figueroa <afiguer7@maisonlive.gmu.edu>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published
+ *  by the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <cstddef>
+
+#include "slab.hpp"
+
+/*
+ * Sparse storage of the internal variables of a GP.
+ *
+ * Only the elements that have history (a Gauss point went non-linear)
+ * own a block of npe x nvar values, where nvar is the count of their
+ * material. The other elements read implicit zeros : <vars_get> returns
+ * nullptr, which the materials take as the virgin state. The blocks are
+ * appended to one growing array and reached through <off>. With a <slab>
+ * the memory comes from it and is released with the slab, a grown array
+ * leaves its old copy behind (at most the size of the new one).
+ */
+
+typedef struct {
+  int nelem;
+  int npe;
+  int nactive;            // elements with a block
+  long size;              // values in use
+  long capacity;          // values allocated
+  long *off = NULL;       // off[e] : start of the block of element e in <vals>, -1 if none
+  double *vals = NULL;
+  slab_t *slab = NULL;    // owner of <off> and <vals>, NULL for the heap
+
+} vars_map;
+
+int vars_init(vars_map *m, const int nelem, const int npe, slab_t *slab = NULL);
+void vars_clear(vars_map *m);
+double *vars_add(vars_map *m, const int e, const int nvar);
+void vars_reserve(vars_map *m, const long capacity);
+void vars_copy(vars_map *dst, const vars_map *src);
+long vars_get_bytes(const vars_map *m);
+void vars_free(vars_map *m);
+
+inline const double *vars_get(const vars_map *m, const int e, const int gp, const int nvar) {
+  return (m != nullptr && m->off[e] >= 0) ? &m->vals[m->off[e] + gp * nvar] : nullptr;
+}
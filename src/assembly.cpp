@@ -25,30 +25,7 @@
 #include "micropp.hpp"
 
 template <>
-double micropp<3>::assembly_rhs(const double *u, const double *int_vars_old, double *b) {
-  INST_START;
-
-  memset(b, 0., nndim * sizeof(double));
-
-  double be[dim * npe];
-  int index[dim * npe];
-
-  for (int ez = 0; ez < nez; ++ez) {
-    for (int ey = 0; ey < ney; ++ey) {
-      for (int ex = 0; ex < nex; ++ex) {
-        int n[npe];
-        get_elem_nodes(n, nx, ny, ex, ey, ez);
-
-        for (int j = 0; j < npe; ++j)
-          for (int d = 0; d < dim; ++d) index[j * dim + d] = n[j] * dim + d;
-
-        get_elem_rhs(u, int_vars_old, be, ex, ey, ez);
-
-        for (int i = 0; i < npe * dim; ++i) b[index[i]] += be[i];
-      }
-    }
-  }
-
+double micropp<3>::set_rhs_bc(double *b) const {
   // boundary conditions
   for (int i = 0; i < nx; ++i) {
     for (int j = 0; j < ny; ++j) {
@@ -92,18 +69,106 @@ double micropp<3>::assembly_rhs(const double *u, const double *int_vars_old, dou
     }
   }
 
-  // Common
-  for (int i = 0; i < nndim; ++i) b[i] = -b[i];
-
+  // Common : sign and norm in the same pass
   double norm = 0.0;
-  for (int i = 0; i < nndim; ++i) norm += b[i] * b[i];
+  for (int i = 0; i < nndim; ++i) {
+    b[i] = -b[i];
+    norm += b[i] * b[i];
+  }
   norm = sqrt(norm);
 
   return norm;
 }
 
 template <>
-void micropp<3>::assembly_mat(ell_matrix *A, const double *u, const double *int_vars_old) {
+double micropp<3>::assembly_rhs(const double *u, const vars_map *int_vars_old, double *b, double *stress_ave) {
+  INST_START;
+
+  memset(b, 0., nndim * sizeof(double));
+  if (stress_ave) {
+    memset(stress_ave, 0, nvoi * sizeof(double));
+  }
+
+  double be[dim * npe];
+  double stress_e[nvoi];
+  int index[dim * npe];
+
+  for (int ez = 0; ez < nez; ++ez) {
+    for (int ey = 0; ey < ney; ++ey) {
+      for (int ex = 0; ex < nex; ++ex) {
+        int n[npe];
+        get_elem_nodes(n, nx, ny, ex, ey, ez);
+
+        for (int j = 0; j < npe; ++j)
+          for (int d = 0; d < dim; ++d) index[j * dim + d] = n[j] * dim + d;
+
+        get_elem_rhs(u, int_vars_old, be, ex, ey, ez, (stress_ave) ? stress_e : nullptr);
+
+        for (int i = 0; i < npe * dim; ++i) b[index[i]] += be[i];
+        if (stress_ave) {
+          for (int v = 0; v < nvoi; ++v) stress_ave[v] += stress_e[v];
+        }
+      }
+    }
+  }
+  if (stress_ave) {
+    for (int v = 0; v < nvoi; ++v) stress_ave[v] /= vol_tot;
+  }
+
+  return set_rhs_bc(b);
+}
+
+template <>
+double micropp<3>::assembly_rhs_mat(ell_matrix *A, const double *u, const vars_map *int_vars_old, double *b,
+                                     double *stress_ave) {
+  INST_START;
+
+  /*
+   * Fused assembly : one sweep over the elements gives <b>, <A> and the
+   * norm of <b>, the strain and the stress of each Gauss point are
+   * computed once and are the base of the tangent perturbation.
+   */
+
+  memset(b, 0., nndim * sizeof(double));
+  ell_set_zero_mat(A);
+  if (stress_ave) {
+    memset(stress_ave, 0, nvoi * sizeof(double));
+  }
+
+  double be[dim * npe];
+  double stress_e[nvoi];
+  double Ae[npe * dim * npe * dim];
+  int index[dim * npe];
+
+  for (int ez = 0; ez < nez; ++ez) {
+    for (int ey = 0; ey < ney; ++ey) {
+      for (int ex = 0; ex < nex; ++ex) {
+        int n[npe];
+        get_elem_nodes(n, nx, ny, ex, ey, ez);
+
+        for (int j = 0; j < npe; ++j)
+          for (int d = 0; d < dim; ++d) index[j * dim + d] = n[j] * dim + d;
+
+        get_elem_rhs_mat(u, int_vars_old, be, Ae, ex, ey, ez, (stress_ave) ? stress_e : nullptr);
+
+        for (int i = 0; i < npe * dim; ++i) b[index[i]] += be[i];
+        ell_add_3D(A, ex, ey, ez, Ae);
+        if (stress_ave) {
+          for (int v = 0; v < nvoi; ++v) stress_ave[v] += stress_e[v];
+        }
+      }
+    }
+  }
+  ell_set_bc_3D(A);
+  if (stress_ave) {
+    for (int v = 0; v < nvoi; ++v) stress_ave[v] /= vol_tot;
+  }
+
+  return set_rhs_bc(b);
+}
+
+template <>
+void micropp<3>::assembly_mat(ell_matrix *A, const double *u, const vars_map *int_vars_old) {
   INST_START;
 
   ell_set_zero_mat(A);
@@ -121,12 +186,15 @@ void micropp<3>::assembly_mat(ell_matrix *A, const double *u, const double *int_
 }
 
 template <int tdim>
-void micropp<tdim>::get_elem_rhs(const double *u, const double *vars_old, double be[npe * dim], int ex, int ey,
-                                 int ez) const {
+void micropp<tdim>::get_elem_rhs(const double *u, const vars_map *vars_old, double be[npe * dim], int ex, int ey,
+                                 int ez, double *stress_e) const {
   constexpr int npedim = npe * dim;
   double stress_gp[nvoi], strain_gp[nvoi];
 
   memset(be, 0, npedim * sizeof(double));
+  if (stress_e) {
+    memset(stress_e, 0, nvoi * sizeof(double));
+  }
 
   for (int gp = 0; gp < npe; ++gp) {
     get_strain(u, gp, strain_gp, bmat, nx, ny, ex, ey, ez);
@@ -134,11 +202,15 @@ void micropp<tdim>::get_elem_rhs(const double *u, const double *vars_old, double
 
     for (int i = 0; i < npedim; ++i)
       for (int j = 0; j < nvoi; ++j) be[i] += bmat[gp][j][i] * stress_gp[j] * wg;
+
+    if (stress_e) {
+      for (int v = 0; v < nvoi; ++v) stress_e[v] += stress_gp[v] * wg;
+    }
   }
 }
 
 template <int tdim>
-void micropp<tdim>::get_elem_mat(const double *u, const double *vars_old, double Ae[npe * dim * npe * dim], int ex,
+void micropp<tdim>::get_elem_mat(const double *u, const vars_map *vars_old, double Ae[npe * dim * npe * dim], int ex,
                                  int ey, int ez) const {
   const int e = glo_elem(ex, ey, ez);
   const material_t *material = get_material(e);
@@ -153,7 +225,7 @@ void micropp<tdim>::get_elem_mat(const double *u, const double *vars_old, double
     double eps[6];
     get_strain(u, gp, eps, bmat, nx, ny, ex, ey, ez);
 
-    const double *vars = (vars_old) ? &vars_old[intvar_ix(e, gp, 0)] : nullptr;
+    const double *vars = vars_get(vars_old, e, gp, material->get_nvars());
     material->get_ctan(eps, (double *)ctan, vars);
 
     double cxb[nvoi][npedim];
@@ -176,3 +248,55 @@ void micropp<tdim>::get_elem_mat(const double *u, const double *vars_old, double
   }
   memcpy(Ae, TAe, npedim2 * sizeof(double));
 }
+
+template <int tdim>
+void micropp<tdim>::get_elem_rhs_mat(const double *u, const vars_map *vars_old, double be[npe * dim],
+                                     double Ae[npe * dim * npe * dim], int ex, int ey, int ez,
+                                     double *stress_e) const {
+  const int e = glo_elem(ex, ey, ez);
+  const material_t *material = get_material(e);
+
+  double stress_gp[nvoi], ctan[nvoi][nvoi];
+  constexpr int npedim = npe * dim;
+  constexpr int npedim2 = npedim * npedim;
+
+  double TAe[npedim2] = {0.0};
+  memset(be, 0, npedim * sizeof(double));
+  if (stress_e) {
+    memset(stress_e, 0, nvoi * sizeof(double));
+  }
+
+  for (int gp = 0; gp < npe; ++gp) {
+    double eps[6];
+    get_strain(u, gp, eps, bmat, nx, ny, ex, ey, ez);
+
+    const double *vars = vars_get(vars_old, e, gp, material->get_nvars());
+    material->get_stress_ctan(eps, stress_gp, (double *)ctan, vars);
+
+    for (int i = 0; i < npedim; ++i)
+      for (int j = 0; j < nvoi; ++j) be[i] += bmat[gp][j][i] * stress_gp[j] * wg;
+
+    if (stress_e) {
+      for (int v = 0; v < nvoi; ++v) stress_e[v] += stress_gp[v] * wg;
+    }
+
+    double cxb[nvoi][npedim];
+
+    for (int i = 0; i < nvoi; ++i) {
+      for (int j = 0; j < npedim; ++j) {
+        double tmp = 0.0;
+        for (int k = 0; k < nvoi; ++k) tmp += ctan[i][k] * bmat[gp][k][j];
+        cxb[i][j] = tmp * wg;
+      }
+    }
+
+    for (int m = 0; m < nvoi; ++m) {
+      for (int i = 0; i < npedim; ++i) {
+        const int inpedim = i * npedim;
+        const double bmatmi = bmat[gp][m][i];
+        for (int j = 0; j < npedim; ++j) TAe[inpedim + j] += bmatmi * cxb[m][j];
+      }
+    }
+  }
+  memcpy(Ae, TAe, npedim2 * sizeof(double));
+}
@@ -55,7 +55,7 @@ void micropp<tdim>::calc_ave_strain(const double *u, double strain_ave[nvoi]) co
 }
 
 template <int tdim>
-void micropp<tdim>::calc_ave_stress(const double *u, double stress_ave[nvoi], const double *vars_old) const {
+void micropp<tdim>::calc_ave_stress(const double *u, double stress_ave[nvoi], const vars_map *vars_old) const {
   memset(stress_ave, 0, nvoi * sizeof(double));
 
   for (int ez = 0; ez < nez; ++ez) {  // 2D -> nez = 1
@@ -82,7 +82,7 @@ void micropp<tdim>::calc_ave_stress(const double *u, double stress_ave[nvoi], co
 }
 
 template <int tdim>
-void micropp<tdim>::calc_fields(double *u, double *vars_old) {
+void micropp<tdim>::calc_fields(const double *u, const vars_map *vars_old, double *strain_e, double *stress_e) const {
   for (int ez = 0; ez < nez; ++ez) {  // 2D -> nez = 1
     for (int ey = 0; ey < ney; ++ey) {
       for (int ex = 0; ex < nex; ++ex) {
@@ -103,8 +103,8 @@ void micropp<tdim>::calc_fields(double *u, double *vars_old) {
 
         const int e = glo_elem(ex, ey, ez);
         for (int v = 0; v < nvoi; ++v) {
-          elem_strain[e * nvoi + v] = eps_a[v] * ivol;
-          elem_stress[e * nvoi + v] = sig_a[v] * ivol;
+          strain_e[e * nvoi + v] = eps_a[v] * ivol;
+          stress_e[e * nvoi + v] = sig_a[v] * ivol;
         }
       }
     }
@@ -0,0 +1,164 @@
+/*
+ *  This source code is part of MicroPP: a finite element library
+ *  to solve microstructural problems for composite materials.
+ *
+ *  Copyright (C) - 2018 - Guido Giuntoli <gagiuntoli@gmail.com>
+ *						   Jimmy Aguilar Mena <kratsbinovish@gmail.com>
+ *                         Judicaël Grasset <judicael.grasset@stfc.ac.uk>
+ *                         Alejandro Figueroa <afiguer7@maisonlive.gmu.edu>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published
+ *  by the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "cfield.hpp"
+
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+static void cfield_reserve(cfield *c, const long bytes) {
+  if (c->capacity < bytes) {
+    c->capacity = (bytes > 3 * c->capacity / 2) ? bytes : 3 * c->capacity / 2;
+    c->data = (unsigned char *)realloc(c->data, c->capacity);
+  }
+}
+
+void cfield_init(cfield *c) {
+  c->n = 0;
+  c->stride = 1;
+  c->step = 0.0;
+  c->size = 0;
+  c->capacity = 0;
+  c->data = NULL;
+}
+
+static void pack_lossless(cfield *c, const double *v, const double *ref, const int n) {
+  /* Counts of leading zero bytes (two per byte) then the remaining bytes */
+  const long nhead = (n + 1) / 2;
+  cfield_reserve(c, nhead + 2L * n);
+  memset(c->data, 0, nhead);
+  long pos = nhead;
+
+  for (int i = 0; i < n; ++i) {
+    uint64_t x, r;
+    memcpy(&x, &v[i], sizeof(uint64_t));
+    memcpy(&r, &ref[i], sizeof(uint64_t));
+    x ^= r;
+
+    int nz = 0;
+    while (nz < 8 && ((x >> (56 - 8 * nz)) & 0xff) == 0) nz++;
+    c->data[i / 2] |= (unsigned char)(nz << (4 * (i % 2)));
+
+    cfield_reserve(c, pos + 8);
+    for (int k = 0; k < 8 - nz; ++k) c->data[pos++] = (unsigned char)(x >> (8 * k));
+  }
+  c->size = pos;
+}
+
+static void unpack_lossless(const cfield *c, const double *ref, double *v) {
+  long pos = (c->n + 1) / 2;
+  for (int i = 0; i < c->n; ++i) {
+    const int nz = (c->data[i / 2] >> (4 * (i % 2))) & 0xf;
+    uint64_t x = 0, r;
+    for (int k = 0; k < 8 - nz; ++k) x |= (uint64_t)c->data[pos++] << (8 * k);
+    memcpy(&r, &ref[i], sizeof(uint64_t));
+    x ^= r;
+    memcpy(&v[i], &x, sizeof(double));
+  }
+}
+
+static void pack_lossy(cfield *c, const double *v, const double *ref, const int n, const double tol) {
+  double max_d = 0.0;
+  for (int i = 0; i < n; ++i) max_d = fmax(max_d, fabs(v[i] - ref[i]));
+  c->step = (max_d > 0.0) ? tol * max_d : 1.0;
+
+  /* Steps taken against the value <stride> positions before (the same component of the previous node) */
+  const int stride = c->stride;
+  int64_t *q = (int64_t *)malloc(stride * sizeof(int64_t));
+  for (int k = 0; k < stride; ++k) q[k] = 0;
+
+  cfield_reserve(c, 2L * n);
+  long pos = 0;
+  for (int i = 0; i < n; ++i) {
+    const int64_t qi = llround((v[i] - ref[i]) / c->step);
+    const int64_t d = qi - q[i % stride];
+    q[i % stride] = qi;
+
+    uint64_t z = ((uint64_t)d << 1) ^ (uint64_t)(d >> 63);
+    cfield_reserve(c, pos + 10);
+    do {
+      c->data[pos++] = (unsigned char)((z & 0x7f) | ((z > 0x7f) ? 0x80 : 0));
+      z >>= 7;
+    } while (z > 0);
+  }
+  c->size = pos;
+  free(q);
+}
+
+static void unpack_lossy(const cfield *c, const double *ref, double *v) {
+  const int stride = c->stride;
+  int64_t *q = (int64_t *)malloc(stride * sizeof(int64_t));
+  for (int k = 0; k < stride; ++k) q[k] = 0;
+
+  long pos = 0;
+  for (int i = 0; i < c->n; ++i) {
+    uint64_t z = 0;
+    int shift = 0;
+    unsigned char byte;
+    do {
+      byte = c->data[pos++];
+      z |= (uint64_t)(byte & 0x7f) << shift;
+      shift += 7;
+    } while (byte & 0x80);
+
+    const int64_t d = (int64_t)(z >> 1) ^ -(int64_t)(z & 1);
+    q[i % stride] += d;
+    v[i] = ref[i] + q[i % stride] * c->step;
+  }
+  free(q);
+}
+
+void cfield_pack(cfield *c, const double *v, const double *ref, const int n, const int stride, const double tol) {
+  c->n = n;
+  c->stride = stride;
+  if (tol > 0.0) {
+    pack_lossy(c, v, ref, n, tol);
+  } else {
+    c->step = 0.0;
+    pack_lossless(c, v, ref, n);
+  }
+}
+
+void cfield_unpack(const cfield *c, const double *ref, double *v) {
+  /* An empty field (never packed) leaves <v> untouched */
+  if (c->n == 0) {
+    return;
+  }
+  if (c->step > 0.0) {
+    unpack_lossy(c, ref, v);
+  } else {
+    unpack_lossless(c, ref, v);
+  }
+}
+
+long cfield_get_bytes(const cfield *c) { return c->capacity; }
+
+void cfield_free(cfield *c) {
+  free(c->data);
+  c->data = NULL;
+  c->capacity = 0;
+  c->size = 0;
+  c->n = 0;
+}
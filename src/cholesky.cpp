@@ -0,0 +1,354 @@
+/*
+ *  This source code is part of MicroPP: a finite element library
+ *  to solve microstructural problems for composite materials.
+ *
+ *  Copyright (C) - 2018 - Guido Giuntoli <gagiuntoli@gmail.com>
+ *						   Jimmy Aguilar Mena <kratsbinovish@gmail.com>
+ *                         Judicaël Grasset <judicael.grasset@stfc.ac.uk>
+ *                         Alejandro Figueroa <afiguer7@maisonlive.gmu.edu>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published
+ *  by the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "cholesky.hpp"
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+#include "instrument.hpp"
+
+using namespace std;
+
+static void nd_order(const int lo[3], const int hi[3], const int nx, const int ny, int *nodes, int *next) {
+  /*
+   * Nested dissection of the box of nodes [lo, hi) : both halves are
+   * numbered first (recursively) and the separator plane at the end.
+   */
+
+  const int s[3] = {hi[0] - lo[0], hi[1] - lo[1], hi[2] - lo[2]};
+  if (s[0] <= 0 || s[1] <= 0 || s[2] <= 0) return;
+
+  if (s[0] * s[1] * s[2] <= ND_LEAF_NODES) {
+    for (int k = lo[2]; k < hi[2]; ++k)
+      for (int j = lo[1]; j < hi[1]; ++j)
+        for (int i = lo[0]; i < hi[0]; ++i) nodes[(*next)++] = nod_index(i, j, k);
+    return;
+  }
+
+  int a = 0;
+  if (s[1] > s[a]) a = 1;
+  if (s[2] > s[a]) a = 2;
+  const int mid = lo[a] + s[a] / 2;
+
+  int hi_1[3] = {hi[0], hi[1], hi[2]};
+  int lo_2[3] = {lo[0], lo[1], lo[2]};
+  hi_1[a] = mid;
+  lo_2[a] = mid + 1;
+
+  nd_order(lo, hi_1, nx, ny, nodes, next);
+  nd_order(lo_2, hi, nx, ny, nodes, next);
+
+  int lo_s[3] = {lo[0], lo[1], lo[2]};
+  int hi_s[3] = {hi[0], hi[1], hi[2]};
+  lo_s[a] = mid;
+  hi_s[a] = mid + 1;
+
+  for (int k = lo_s[2]; k < hi_s[2]; ++k)
+    for (int j = lo_s[1]; j < hi_s[1]; ++j)
+      for (int i = lo_s[0]; i < hi_s[0]; ++i) nodes[(*next)++] = nod_index(i, j, k);
+}
+
+static int ereach(const int n, const long int *Cp, const int *Ci, const int k, const int *parent, int *s, int *w) {
+  /*
+   * Nonzero pattern of the k-th row of L obtained from the elimination
+   * tree. It is returned in s[top..n-1] (topological order).
+   */
+
+  int top = n;
+  w[k] = k;
+  for (long int p = Cp[k]; p < Cp[k + 1]; ++p) {
+    int i = Ci[p];
+    if (i > k) continue;
+    int len = 0;
+    for (; w[i] != k; i = parent[i]) {
+      s[len++] = i;
+      w[i] = k;
+    }
+    while (len > 0) s[--top] = s[--len];
+  }
+  return top;
+}
+
+int chol_init(chol_matrix *L, const ell_matrix *A) {
+  INST_START;
+
+  const int nx = A->n[0];
+  const int ny = A->n[1];
+  const int nz = (A->dim == 3) ? A->n[2] : 1;
+  const int nfield = A->nfield;
+  const int nnz = A->nnz;
+
+  /* Free nodes are the interior ones, the rest have Dirichlet rows */
+
+  const int lo[3] = {1, 1, (A->dim == 3) ? 1 : 0};
+  const int hi[3] = {nx - 1, ny - 1, (A->dim == 3) ? nz - 1 : 1};
+  const int nfree = (hi[0] - lo[0]) * (hi[1] - lo[1]) * (hi[2] - lo[2]);
+
+  int *nodes = (int *)malloc(nfree * sizeof(int));
+  int next = 0;
+  nd_order(lo, hi, nx, ny, nodes, &next);
+  assert(next == nfree);
+
+  const int n = nfree * nfield;
+  L->nrow = A->nrow;
+  L->n = n;
+  L->dof = (int *)malloc(n * sizeof(int));
+
+  int *iperm = (int *)malloc(A->nrow * sizeof(int));
+  for (int i = 0; i < A->nrow; ++i) iperm[i] = -1;
+
+  for (int i = 0; i < nfree; ++i) {
+    for (int f = 0; f < nfield; ++f) {
+      L->dof[i * nfield + f] = nodes[i] * nfield + f;
+      iperm[nodes[i] * nfield + f] = i * nfield + f;
+    }
+  }
+  free(nodes);
+
+  /* Upper triangular part of P A P^T by columns (CSC) */
+
+  long int *Cp = (long int *)malloc((n + 1) * sizeof(long int));
+  Cp[0] = 0;
+  for (int k = 0; k < n; ++k) {
+    const int row = L->dof[k];
+    long int count = 0;
+    for (int j = 0; j < nnz; ++j) {
+      const int i = iperm[A->cols[row * nnz + j]];
+      if (i >= 0 && i <= k) count++;
+    }
+    Cp[k + 1] = Cp[k] + count;
+  }
+
+  int *Ci = (int *)malloc(Cp[n] * sizeof(int));
+  double *Cx = (double *)malloc(Cp[n] * sizeof(double));
+  for (int k = 0; k < n; ++k) {
+    const int row = L->dof[k];
+    long int p = Cp[k];
+    for (int j = 0; j < nnz; ++j) {
+      const int i = iperm[A->cols[row * nnz + j]];
+      if (i >= 0 && i <= k) {
+        Ci[p] = i;
+        Cx[p] = A->vals[row * nnz + j];
+        p++;
+      }
+    }
+  }
+  free(iperm);
+
+  /* Elimination tree */
+
+  int *parent = (int *)malloc(n * sizeof(int));
+  int *ancestor = (int *)malloc(n * sizeof(int));
+  for (int k = 0; k < n; ++k) {
+    parent[k] = -1;
+    ancestor[k] = -1;
+    for (long int p = Cp[k]; p < Cp[k + 1]; ++p) {
+      int i = Ci[p];
+      while (i != -1 && i < k) {
+        const int inext = ancestor[i];
+        ancestor[i] = k;
+        if (inext == -1) parent[i] = k;
+        i = inext;
+      }
+    }
+  }
+  free(ancestor);
+
+  /* Symbolic factorization : column counts of L */
+
+  int *s = (int *)malloc(n * sizeof(int));
+  int *w = (int *)malloc(n * sizeof(int));
+  long int *c = (long int *)malloc(n * sizeof(long int));
+
+  for (int k = 0; k < n; ++k) {
+    w[k] = -1;
+    c[k] = 1;
+  }
+  for (int k = 0; k < n; ++k) {
+    const int top = ereach(n, Cp, Ci, k, parent, s, w);
+    for (int t = top; t < n; ++t) c[s[t]]++;
+  }
+
+  L->Lp = (long int *)malloc((n + 1) * sizeof(long int));
+  L->Lp[0] = 0;
+  for (int k = 0; k < n; ++k) L->Lp[k + 1] = L->Lp[k] + c[k];
+
+  L->Li = (int *)malloc(L->Lp[n] * sizeof(int));
+  L->Lx = (double *)malloc(L->Lp[n] * sizeof(double));
+
+  /* Numeric factorization (up-looking) */
+
+  double *x = (double *)calloc(n, sizeof(double));
+  for (int k = 0; k < n; ++k) {
+    w[k] = -1;
+    c[k] = L->Lp[k];
+  }
+
+  int ierr = 0;
+  for (int k = 0; k < n; ++k) {
+    const int top = ereach(n, Cp, Ci, k, parent, s, w);
+
+    for (long int p = Cp[k]; p < Cp[k + 1]; ++p) x[Ci[p]] = Cx[p];
+
+    double d = x[k];
+    x[k] = 0.0;
+
+    for (int t = top; t < n; ++t) {
+      const int i = s[t];
+      const double lki = x[i] / L->Lx[L->Lp[i]];
+      x[i] = 0.0;
+      for (long int p = L->Lp[i] + 1; p < c[i]; ++p) x[L->Li[p]] -= L->Lx[p] * lki;
+      d -= lki * lki;
+      const long int p = c[i]++;
+      L->Li[p] = k;
+      L->Lx[p] = lki;
+    }
+
+    if (d <= 0.0) {
+      ierr = 1;
+      break;
+    }
+
+    const long int p = c[k]++;
+    L->Li[p] = k;
+    L->Lx[p] = sqrt(d);
+  }
+
+  free(x);
+  free(c);
+  free(w);
+  free(s);
+  free(parent);
+  free(Ci);
+  free(Cx);
+  free(Cp);
+
+  if (ierr) {
+    cerr << "chol_init: the matrix is not positive definite" << endl;
+  }
+  return ierr;
+}
+
+void chol_solve(const chol_matrix *L, const double *b, double *x, double *work) {
+  INST_START;
+
+  /*
+   * x = P^T L^-T L^-1 P b on the free dofs, x = b on the Dirichlet ones.
+   * <work> is scratch of the caller as <L> is shared by the threads.
+   */
+
+  const int n = L->n;
+  const long int *Lp = L->Lp;
+  const int *Li = L->Li;
+  const double *Lx = L->Lx;
+
+  double *y = work;
+  for (int k = 0; k < n; ++k) y[k] = b[L->dof[k]];
+
+  for (int j = 0; j < n; ++j) {
+    y[j] /= Lx[Lp[j]];
+    for (long int p = Lp[j] + 1; p < Lp[j + 1]; ++p) y[Li[p]] -= Lx[p] * y[j];
+  }
+
+  for (int j = n - 1; j >= 0; --j) {
+    for (long int p = Lp[j] + 1; p < Lp[j + 1]; ++p) y[j] -= Lx[p] * y[Li[p]];
+    y[j] /= Lx[Lp[j]];
+  }
+
+  memcpy(x, b, L->nrow * sizeof(double));
+  for (int k = 0; k < n; ++k) x[L->dof[k]] = y[k];
+}
+
+long int chol_get_nnz(const chol_matrix *L) { return L->Lp[L->n]; }
+
+long chol_get_bytes(const chol_matrix *L) {
+  return L->n * sizeof(int) + (L->n + 1) * sizeof(long int) + chol_get_nnz(L) * (sizeof(int) + sizeof(double));
+}
+
+void chol_free(chol_matrix *L) {
+  if (L->dof != NULL) free(L->dof);
+  if (L->Lp != NULL) free(L->Lp);
+  if (L->Li != NULL) free(L->Li);
+  if (L->Lx != NULL) free(L->Lx);
+}
+
+int ell_solve_cg_chol(const ell_matrix *m, ell_solver *s, const chol_matrix *L, const double *b, double *x,
+                      double *err) {
+  INST_START;
+
+  /*
+   * Conjugate Gradient Algorithm (CG) preconditioned with the factor <L>,
+   * s->Ap is free at the preconditioning steps and serves as its scratch
+   */
+
+  if (!m || !s || !L || !b || !x) return 1;
+
+  for (int i = 0; i < m->nrow; ++i) x[i] = 0.0;
+
+  ell_mvp(m, x, s->r);
+
+  for (int i = 0; i < m->nrow; ++i) s->r[i] = b[i] - s->r[i];
+
+  chol_solve(L, s->r, s->z, s->Ap);
+
+  for (int i = 0; i < m->nrow; ++i) s->p[i] = s->z[i];
+
+  double rz = get_dot(s->r, s->z, m->nrow);
+
+  double pnorm_0 = sqrt(get_dot(s->z, s->z, m->nrow));
+  double pnorm = pnorm_0;
+
+  int its = 0;
+  while (its < s->max_its) {
+    if (pnorm < s->min_err || pnorm < pnorm_0 * s->rel_err) break;
+
+    ell_mvp(m, s->p, s->Ap);
+    double pAp = get_dot(s->p, s->Ap, m->nrow);
+
+    const double alpha = rz / pAp;
+
+    for (int i = 0; i < m->nrow; ++i) x[i] += alpha * s->p[i];
+
+    for (int i = 0; i < m->nrow; ++i) s->r[i] -= alpha * s->Ap[i];
+
+    chol_solve(L, s->r, s->z, s->Ap);
+
+    pnorm = sqrt(get_dot(s->z, s->z, m->nrow));
+
+    double rz_n = get_dot(s->r, s->z, m->nrow);
+
+    const double beta = rz_n / rz;
+    for (int i = 0; i < m->nrow; ++i) s->p[i] = s->z[i] + beta * s->p[i];
+
+    rz = rz_n;
+    its++;
+  }
+
+  *err = rz;
+
+  INST_ITS(its);
+  return its;
+}
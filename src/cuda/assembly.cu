@@ -157,7 +157,7 @@ __global__ void assembly_kernel(ell_matrix *A_d, double *vals_d, const double *u
 }
 
 template <>
-void micropp<3>::assembly_mat(ell_matrix *A, const double *u, const double *vars_old) {
+void micropp<3>::assembly_mat(ell_matrix *A, const double *u, const vars_map *vars_old) {
   INST_START;
 
   cout << "assembly_mat_cuda" << endl;
@@ -260,7 +260,7 @@ __global__ void assembly_rhs_kernel(double *b_d, const double *u, int *elem_type
 }
 
 template <>
-double micropp<3>::assembly_rhs(const double *u, const double *vars_old, double *b) {
+double micropp<3>::assembly_rhs(const double *u, const vars_map *vars_old, double *b, double *stress_ave) {
   INST_START;
 
   cout << "assembly_rhs_cuda" << endl;
@@ -347,5 +347,17 @@ double micropp<3>::assembly_rhs(const double *u, const double *vars_old, double
   for (int i = 0; i < nndim; ++i) norm += b[i] * b[i];
   norm = sqrt(norm);
 
+  if (stress_ave) {
+    calc_ave_stress(u, stress_ave, vars_old);
+  }
+
   return norm;
 }
+
+template <>
+double micropp<3>::assembly_rhs_mat(ell_matrix *A, const double *u, const vars_map *vars_old, double *b,
+                                     double *stress_ave) {
+  /* Not fused in this backend */
+  assembly_mat(A, u, vars_old);
+  return assembly_rhs(u, vars_old, b, stress_ave);
+}
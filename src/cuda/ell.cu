@@ -129,7 +129,7 @@ __global__ void reduce(double *res_d, const double *arr_d, const int n) {
   }
 }
 
-int ell_solve_cgpd(const ell_matrix *m, const double *b, double *x, double *err) {
+int ell_solve_cgpd(const ell_matrix *m, ell_solver *s, const double *b, double *x, double *err) {
   INST_START;
 
   const int grid = 512;
@@ -170,18 +170,18 @@ int ell_solve_cgpd(const ell_matrix *m, const double *b, double *x, double *err)
 
   /* Conjugate Gradient Algorithm (CG) with Jacobi Preconditioner */
 
-  if (!m || !b || !x) return 1;
+  if (!m || !s || !b || !x) return 1;
 
   for (int i = 0; i < m->nn; i++) {
     for (int d = 0; d < m->nfield; d++)
-      m->k[i * m->nfield + d] = 1 / m->vals[i * m->nfield * m->nnz + m->shift * m->nfield + d * m->nnz + d];
+      s->k[i * m->nfield + d] = 1 / m->vals[i * m->nfield * m->nnz + m->shift * m->nfield + d * m->nnz + d];
   }
 
   cudaMemset(x_d, 0, m->nrow * sizeof(double));
 
   cudaMemcpy(r_d, b, m->nrow * sizeof(double), cudaMemcpyHostToDevice);
 
-  cudaMemcpy(k_d, m->k, m->nrow * sizeof(double), cudaMemcpyHostToDevice);
+  cudaMemcpy(k_d, s->k, m->nrow * sizeof(double), cudaMemcpyHostToDevice);
   dot_i<<<grid, block>>>(z_d, k_d, r_d, m->nrow);
 
   cudaMemcpy(p_d, z_d, m->nrow * sizeof(double), cudaMemcpyDeviceToDevice);
@@ -200,8 +200,8 @@ int ell_solve_cgpd(const ell_matrix *m, const double *b, double *x, double *err)
   cout << m->nrow << endl;
 
   int its = 0;
-  while (its < m->max_its) {
-    if (pnorm < m->min_err || pnorm < pnorm_0 * m->rel_err) break;
+  while (its < s->max_its) {
+    if (pnorm < s->min_err || pnorm < pnorm_0 * s->rel_err) break;
 
     dim3 grid_mvp(5000, 1, 1);
     dim3 block_mvp(1, 128, 1);
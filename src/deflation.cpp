@@ -0,0 +1,386 @@
+/*
+ *  This source code is part of MicroPP: a finite element library
+ *  to solve microstructural problems for composite materials.
+ *
+ *  Copyright (C) - 2018 - Guido Giuntoli <gagiuntoli@gmail.com>
+ *						   Jimmy Aguilar Mena <kratsbinovish@gmail.com>
+ *                         Judicaël Grasset <judicael.grasset@stfc.ac.uk>
+ *                         Alejandro Figueroa <afiguer7@maisonlive.gmu.edu>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published
+ *  by the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "deflation.hpp"
+
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+
+#include "instrument.hpp"
+
+using namespace std;
+
+static void defl_wtv(const defl_space *d, const double *v, double *y) {
+  /* y = W^T v */
+
+  for (int i = 0; i < d->ndef; ++i) y[i] = 0.0;
+
+  for (int n = 0; n < d->nrow / d->nfield; ++n) {
+    if (d->blk[n] < 0) continue;
+    for (int f = 0; f < d->nfield; ++f) y[d->blk[n] * d->nfield + f] += v[n * d->nfield + f];
+  }
+}
+
+static void defl_wtav(const defl_space *d, const double *v, double *y) {
+  /* y = W^T A v */
+
+  for (int i = 0; i < d->ndef; ++i) y[i] = 0.0;
+
+  for (int n = 0; n < d->nrow / d->nfield; ++n) {
+    if (d->blk[n] < 0) continue;
+    for (int fj = 0; fj < d->nfield; ++fj) {
+      const int col = n * d->nfield + fj;
+      for (int s = 0; s < d->width; ++s) {
+        const int b = d->aw_blk[n * d->width + s];
+        if (b < 0) break;
+        const double *wta = &d->wta_vals[(col * d->width + s) * d->nfield];
+        for (int f = 0; f < d->nfield; ++f) y[b * d->nfield + f] += wta[f] * v[col];
+      }
+    }
+  }
+}
+
+static void defl_wy(const defl_space *d, const double alpha, const double *y, double *x) {
+  /* x += alpha W y */
+
+  for (int n = 0; n < d->nrow / d->nfield; ++n) {
+    if (d->blk[n] < 0) continue;
+    for (int f = 0; f < d->nfield; ++f) x[n * d->nfield + f] += alpha * y[d->blk[n] * d->nfield + f];
+  }
+}
+
+static void defl_coarse_solve(const defl_space *d, double *y) {
+  /* y = E^-1 y with the dense factors P E = L U */
+
+  const int k = d->ndef;
+  const double *LU = d->E;
+
+  for (int i = 0; i < k; ++i) {
+    const int p = d->piv[i];
+    const double tmp = y[i];
+    y[i] = y[p];
+    y[p] = tmp;
+  }
+
+  for (int i = 0; i < k; ++i) {
+    double sum = y[i];
+    for (int j = 0; j < i; ++j) sum -= LU[i * k + j] * y[j];
+    y[i] = sum;
+  }
+
+  for (int i = k - 1; i >= 0; --i) {
+    double sum = y[i];
+    for (int j = i + 1; j < k; ++j) sum -= LU[i * k + j] * y[j];
+    y[i] = sum / LU[i * k + i];
+  }
+}
+
+int defl_init(defl_space *d, const int nfield, const int dim, const int ns[3], const int nb) {
+  /*
+   * Builds the boxes of the free nodes and the pattern of A W, both only
+   * depend on the grid. Returns 1 if there are no free nodes to deflate.
+   */
+
+  const int nx = ns[0];
+  const int ny = ns[1];
+  const int nz = (dim == 3) ? ns[2] : 1;
+  const int nn = nx * ny * nz;
+
+  const int nfree[3] = {nx - 2, ny - 2, (dim == 3) ? nz - 2 : 1};
+  if (nb < 1 || nfree[0] < 1 || nfree[1] < 1 || nfree[2] < 1) return 1;
+
+  int nbox[3];
+  for (int i = 0; i < 3; ++i) nbox[i] = (nb < nfree[i]) ? nb : nfree[i];
+
+  d->nrow = nn * nfield;
+  d->nfield = nfield;
+  d->ndef = nbox[0] * nbox[1] * nbox[2] * nfield;
+  d->blk = (int *)malloc(nn * sizeof(int));
+
+  const int k0 = (dim == 3) ? 1 : 0;
+  for (int n = 0; n < nn; ++n) d->blk[n] = -1;
+  for (int k = k0; k < k0 + nfree[2]; ++k) {
+    for (int j = 1; j < ny - 1; ++j) {
+      for (int i = 1; i < nx - 1; ++i) {
+        const int bx = (i - 1) * nbox[0] / nfree[0];
+        const int by = (j - 1) * nbox[1] / nfree[1];
+        const int bz = (k - k0) * nbox[2] / nfree[2];
+        d->blk[nod_index(i, j, k)] = (bz * nbox[1] + by) * nbox[0] + bx;
+      }
+    }
+  }
+
+  /* Boxes reached by the neighbours of each free node (A W couples them) */
+
+  const int kw = (dim == 3) ? 1 : 0;
+  d->width = (dim == 3) ? 27 : 9;
+  d->aw_blk = (int *)malloc(nn * d->width * sizeof(int));
+
+  int width = 0;
+  for (int k = 0; k < nz; ++k) {
+    for (int j = 0; j < ny; ++j) {
+      for (int i = 0; i < nx; ++i) {
+        const int n = nod_index(i, j, k);
+        int *const list = &d->aw_blk[n * d->width];
+        for (int s = 0; s < d->width; ++s) list[s] = -1;
+        if (d->blk[n] < 0) continue;
+
+        int count = 0;
+        for (int kk = k - kw; kk <= k + kw; ++kk) {
+          for (int jj = j - 1; jj <= j + 1; ++jj) {
+            for (int ii = i - 1; ii <= i + 1; ++ii) {
+              const int b = d->blk[nod_index(ii, jj, kk)];
+              if (b < 0) continue;
+              int s = 0;
+              while (s < count && list[s] != b) s++;
+              if (s == count) list[count++] = b;
+            }
+          }
+        }
+        if (count > width) width = count;
+      }
+    }
+  }
+
+  /* Compact the lists to the actual maximum of coupled boxes */
+
+  for (int n = 0; n < nn; ++n)
+    for (int s = 0; s < width; ++s) d->aw_blk[n * width + s] = d->aw_blk[n * d->width + s];
+  d->width = width;
+
+  d->aw_vals = (double *)malloc(d->nrow * d->width * nfield * sizeof(double));
+  d->wta_vals = (double *)malloc(d->nrow * d->width * nfield * sizeof(double));
+  d->E = (double *)malloc(d->ndef * d->ndef * sizeof(double));
+  d->piv = (int *)malloc(d->ndef * sizeof(int));
+  d->y = (double *)malloc(d->ndef * sizeof(double));
+
+  return 0;
+}
+
+int defl_update(defl_space *d, const ell_matrix *A) {
+  INST_START;
+
+  /*
+   * Computes A W, W^T A and the LU factors of E = W^T A W for the current
+   * values of <A>. The tangent of the non-linear materials is not always
+   * symmetric so E is not factorized with Cholesky. Returns 1 if E is
+   * singular.
+   */
+
+  const int nfield = d->nfield;
+  const int width = d->width;
+  const int num_nodes = (A->dim == 3) ? 27 : 9;
+  const int k = d->ndef;
+
+  memset(d->aw_vals, 0, d->nrow * width * nfield * sizeof(double));
+  memset(d->wta_vals, 0, d->nrow * width * nfield * sizeof(double));
+  memset(d->E, 0, k * k * sizeof(double));
+
+  for (int n = 0; n < A->nn; ++n) {
+    const int bn = d->blk[n];
+    if (bn < 0) continue;
+    const int *list_n = &d->aw_blk[n * width];
+    for (int fi = 0; fi < nfield; ++fi) {
+      const int row = n * nfield + fi;
+      for (int j = 0; j < num_nodes; ++j) {
+        const int ix = row * A->nnz + j * nfield;
+        const int cn = A->cols[ix] / nfield;
+        const int b = d->blk[cn];
+        if (b < 0) continue;
+
+        int s = 0;
+        while (list_n[s] != b) s++;
+        double *aw = &d->aw_vals[(row * width + s) * nfield];
+        for (int f = 0; f < nfield; ++f) aw[f] += A->vals[ix + f];
+
+        const int *list_c = &d->aw_blk[cn * width];
+        s = 0;
+        while (list_c[s] != bn) s++;
+        for (int f = 0; f < nfield; ++f) d->wta_vals[((cn * nfield + f) * width + s) * nfield + fi] += A->vals[ix + f];
+      }
+
+      const int ei = bn * nfield + fi;
+      for (int s = 0; s < width && list_n[s] >= 0; ++s) {
+        const double *aw = &d->aw_vals[(row * width + s) * nfield];
+        for (int f = 0; f < nfield; ++f) d->E[ei * k + list_n[s] * nfield + f] += aw[f];
+      }
+    }
+  }
+
+  /* Dense LU with partial pivoting, L (unit diagonal) and U overwrite E */
+
+  double *LU = d->E;
+  for (int j = 0; j < k; ++j) {
+    int p = j;
+    for (int i = j + 1; i < k; ++i)
+      if (fabs(LU[i * k + j]) > fabs(LU[p * k + j])) p = i;
+    d->piv[j] = p;
+
+    if (LU[p * k + j] == 0.0) {
+      cerr << "Deflation : coarse matrix is singular" << endl;
+      return 1;
+    }
+
+    if (p != j) {
+      for (int c = 0; c < k; ++c) {
+        const double tmp = LU[j * k + c];
+        LU[j * k + c] = LU[p * k + c];
+        LU[p * k + c] = tmp;
+      }
+    }
+
+    for (int i = j + 1; i < k; ++i) {
+      const double l = LU[i * k + j] / LU[j * k + j];
+      LU[i * k + j] = l;
+      for (int c = j + 1; c < k; ++c) LU[i * k + c] -= l * LU[j * k + c];
+    }
+  }
+
+  return 0;
+}
+
+long defl_get_bytes(const defl_space *d) {
+  const long nn = d->nrow / d->nfield;
+  return nn * (1 + d->width) * sizeof(int) + 2L * d->nrow * d->width * d->nfield * sizeof(double) +
+         (long)d->ndef * d->ndef * sizeof(double) + d->ndef * (sizeof(int) + sizeof(double));
+}
+
+void defl_free(defl_space *d) {
+  free(d->blk);
+  free(d->aw_blk);
+  free(d->aw_vals);
+  free(d->wta_vals);
+  free(d->E);
+  free(d->piv);
+  free(d->y);
+  d->blk = NULL;
+  d->aw_blk = NULL;
+  d->aw_vals = NULL;
+  d->wta_vals = NULL;
+  d->E = NULL;
+  d->piv = NULL;
+  d->y = NULL;
+}
+
+int ell_solve_dcg(const ell_matrix *m, ell_solver *s, const defl_space *d, const double *b, double *x, double *err,
+                  const bool use_x0, double *y) {
+  INST_START;
+
+  /*
+   * Deflated Conjugate Gradient (Saad et al., 2000) with Jacobi
+   * Preconditioner. The search directions are kept A-orthogonal to W so
+   * the coarse error components are solved exactly by E.
+   */
+
+  if (!m || !s || !d || !b || !x) return 1;
+
+  for (int i = 0; i < m->nn; i++) {
+    for (int f = 0; f < m->nfield; f++)
+      s->k[i * m->nfield + f] = 1 / m->vals[i * m->nfield * m->nnz + m->shift * m->nfield + f * m->nnz + f];
+  }
+
+  if (y == NULL) y = d->y;
+
+  /*
+   * x_0 = x_g + W E^-1 W^T r_g and r_0 = r_g - A W E^-1 W^T r_g where
+   * r_g = b - A x_g is the residual of the initial guess (x_g = 0 by default)
+   */
+
+  if (use_x0) {
+    ell_mvp(m, x, s->r);
+    for (int i = 0; i < m->nrow; ++i) s->r[i] = b[i] - s->r[i];
+  } else {
+    for (int i = 0; i < m->nrow; ++i) x[i] = 0.0;
+    for (int i = 0; i < m->nrow; ++i) s->r[i] = b[i];
+  }
+
+  defl_wtv(d, s->r, y);
+  defl_coarse_solve(d, y);
+
+  defl_wy(d, 1.0, y, x);
+
+  for (int n = 0; n < m->nn; ++n) {
+    for (int fi = 0; fi < m->nfield; ++fi) {
+      const int row = n * m->nfield + fi;
+      double sum = s->r[row];
+      for (int t = 0; t < d->width && d->blk[n] >= 0; ++t) {
+        const int bt = d->aw_blk[n * d->width + t];
+        if (bt < 0) break;
+        const double *aw = &d->aw_vals[(row * d->width + t) * m->nfield];
+        for (int f = 0; f < m->nfield; ++f) sum -= aw[f] * y[bt * m->nfield + f];
+      }
+      s->r[row] = sum;
+    }
+  }
+
+  for (int i = 0; i < m->nrow; ++i) s->z[i] = s->k[i] * s->r[i];
+
+  /* p_0 = z_0 - W E^-1 W^T A z_0 */
+
+  for (int i = 0; i < m->nrow; ++i) s->p[i] = s->z[i];
+  defl_wtav(d, s->z, y);
+  defl_coarse_solve(d, y);
+  defl_wy(d, -1.0, y, s->p);
+
+  double rz = get_dot(s->r, s->z, m->nrow);
+
+  /* Same reference as the plain CG (x_0 = 0) so both stop at the same error */
+  const double pnorm_0 = ell_get_pnorm_0(s, b, m->nrow);
+  double pnorm = sqrt(get_dot(s->z, s->z, m->nrow));
+
+  int its = 0;
+  while (its < s->max_its) {
+    if (pnorm < s->min_err || pnorm < pnorm_0 * s->rel_err) break;
+
+    ell_mvp(m, s->p, s->Ap);
+    double pAp = get_dot(s->p, s->Ap, m->nrow);
+
+    const double alpha = rz / pAp;
+
+    for (int i = 0; i < m->nrow; ++i) x[i] += alpha * s->p[i];
+
+    for (int i = 0; i < m->nrow; ++i) s->r[i] -= alpha * s->Ap[i];
+
+    for (int i = 0; i < m->nrow; ++i) s->z[i] = s->k[i] * s->r[i];
+
+    pnorm = sqrt(get_dot(s->z, s->z, m->nrow));
+
+    double rz_n = get_dot(s->r, s->z, m->nrow);
+
+    const double beta = rz_n / rz;
+    for (int i = 0; i < m->nrow; ++i) s->p[i] = s->z[i] + beta * s->p[i];
+
+    defl_wtav(d, s->z, y);
+    defl_coarse_solve(d, y);
+    defl_wy(d, -1.0, y, s->p);
+
+    rz = rz_n;
+    its++;
+  }
+
+  *err = rz;
+
+  INST_ITS(its);
+  return its;
+}
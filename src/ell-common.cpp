@@ -31,14 +31,11 @@
 
 using namespace std;
 
-void ell_init(ell_matrix *m, const int nfield, const int dim, const int ns[3], const double min_err,
-              const double rel_err, const int max_its) {
+void ell_init(ell_matrix *m, const int nfield, const int dim, const int ns[3]) {
   memcpy(m->n, ns, 3 * sizeof(int));
   assert(ns[0] >= 0 && ns[1] >= 0 && ns[2] >= 0);
   assert(dim >= 2 && dim <= 3);
   assert(nfield > 0);
-  assert(max_its > 0);
-  assert(min_err > 0);
 
   const int nx = ns[0];
   const int ny = ns[1];
@@ -59,15 +56,6 @@ void ell_init(ell_matrix *m, const int nfield, const int dim, const int ns[3], c
   m->cols = (int *)malloc(nnz * nrow * sizeof(int));
   m->vals = (double *)malloc(nnz * nrow * sizeof(double));
 
-  m->max_its = max_its;
-  m->min_err = min_err;
-  m->rel_err = rel_err;
-  m->k = (double *)malloc(nn * nfield * sizeof(double));
-  m->r = (double *)malloc(nn * nfield * sizeof(double));
-  m->z = (double *)malloc(nn * nfield * sizeof(double));
-  m->p = (double *)malloc(nn * nfield * sizeof(double));
-  m->Ap = (double *)malloc(nn * nfield * sizeof(double));
-
   if (dim == 2) {
     for (int fi = 0; fi < nfield; ++fi) {
       for (int xi = 0; xi < nx; ++xi) {
@@ -138,6 +126,22 @@ void ell_init(ell_matrix *m, const int nfield, const int dim, const int ns[3], c
   }
 }
 
+void ell_solver_init(ell_solver *s, const int nrow, const double min_err, const double rel_err, const int max_its) {
+  assert(nrow > 0);
+  assert(max_its > 0);
+  assert(min_err > 0);
+
+  s->nrow = nrow;
+  s->max_its = max_its;
+  s->min_err = min_err;
+  s->rel_err = rel_err;
+  s->k = (double *)malloc(nrow * sizeof(double));
+  s->r = (double *)malloc(nrow * sizeof(double));
+  s->z = (double *)malloc(nrow * sizeof(double));
+  s->p = (double *)malloc(nrow * sizeof(double));
+  s->Ap = (double *)malloc(nrow * sizeof(double));
+}
+
 void ell_add_2D(ell_matrix *m, int ex, int ey, const double *Ae) {
   // assembly Ae in 2D structured grid representation
   // nFields : number of scalar components on each node
@@ -299,11 +303,18 @@ void ell_set_bc_3D(ell_matrix *m) {
 void ell_free(ell_matrix *m) {
   if (m->cols != NULL) free(m->cols);
   if (m->vals != NULL) free(m->vals);
-  if (m->k != NULL) free(m->k);
-  if (m->r != NULL) free(m->r);
-  if (m->z != NULL) free(m->z);
-  if (m->p != NULL) free(m->p);
-  if (m->Ap != NULL) free(m->Ap);
+}
+
+long ell_get_bytes(const ell_matrix *m) { return (long)m->nrow * m->nnz * (sizeof(int) + sizeof(double)); }
+
+long ell_solver_get_bytes(const ell_solver *s) { return 5L * s->nrow * sizeof(double); }
+
+void ell_solver_free(ell_solver *s) {
+  if (s->k != NULL) free(s->k);
+  if (s->r != NULL) free(s->r);
+  if (s->z != NULL) free(s->z);
+  if (s->p != NULL) free(s->p);
+  if (s->Ap != NULL) free(s->Ap);
 }
 
 int ell_write(string filename, const ell_matrix *A) {
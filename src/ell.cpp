@@ -63,54 +63,67 @@ double ell_get_norm(const ell_matrix *m) {
   return sqrt(norm);
 }
 
-int ell_solve_cgpd(const ell_matrix *m, const double *b, double *x, double *err) {
+double ell_get_pnorm_0(const ell_solver *s, const double *b, const int n) {
+  /*
+   * Preconditioned norm of the residual for x = 0. It is the reference of
+   * the relative tolerance also when CG starts from an initial guess so a
+   * warm start does not make the stop criterion stricter.
+   */
+  double norm = 0.0;
+  for (int i = 0; i < n; ++i) norm += (s->k[i] * b[i]) * (s->k[i] * b[i]);
+  return sqrt(norm);
+}
+
+int ell_solve_cgpd(const ell_matrix *m, ell_solver *s, const double *b, double *x, double *err, const bool use_x0) {
   INST_START;
 
   /* Conjugate Gradient Algorithm (CG) with Jacobi Preconditioner */
 
-  if (!m || !b || !x) return 1;
+  if (!m || !s || !b || !x) return 1;
 
   for (int i = 0; i < m->nn; i++) {
     for (int d = 0; d < m->nfield; d++)
-      m->k[i * m->nfield + d] = 1 / m->vals[i * m->nfield * m->nnz + m->shift * m->nfield + d * m->nnz + d];
+      s->k[i * m->nfield + d] = 1 / m->vals[i * m->nfield * m->nnz + m->shift * m->nfield + d * m->nnz + d];
   }
 
-  for (int i = 0; i < m->nrow; ++i) x[i] = 0.0;
+  if (!use_x0) {
+    for (int i = 0; i < m->nrow; ++i) x[i] = 0.0;
+  }
 
-  ell_mvp(m, x, m->r);
+  ell_mvp(m, x, s->r);
 
-  for (int i = 0; i < m->nrow; ++i) m->r[i] = b[i] - m->r[i];
+  for (int i = 0; i < m->nrow; ++i) s->r[i] = b[i] - s->r[i];
 
-  for (int i = 0; i < m->nrow; ++i) m->z[i] = m->k[i] * m->r[i];
+  for (int i = 0; i < m->nrow; ++i) s->z[i] = s->k[i] * s->r[i];
 
-  for (int i = 0; i < m->nrow; ++i) m->p[i] = m->z[i];
+  for (int i = 0; i < m->nrow; ++i) s->p[i] = s->z[i];
 
-  double rz = get_dot(m->r, m->z, m->nrow);
+  double rz = get_dot(s->r, s->z, m->nrow);
 
-  double pnorm_0 = sqrt(get_dot(m->z, m->z, m->nrow));
-  double pnorm = pnorm_0;
+  double pnorm = sqrt(get_dot(s->z, s->z, m->nrow));
+  const double pnorm_0 = (use_x0) ? ell_get_pnorm_0(s, b, m->nrow) : pnorm;
 
   int its = 0;
-  while (its < m->max_its) {
-    if (pnorm < m->min_err || pnorm < pnorm_0 * m->rel_err) break;
+  while (its < s->max_its) {
+    if (pnorm < s->min_err || pnorm < pnorm_0 * s->rel_err) break;
 
-    ell_mvp(m, m->p, m->Ap);
-    double pAp = get_dot(m->p, m->Ap, m->nrow);
+    ell_mvp(m, s->p, s->Ap);
+    double pAp = get_dot(s->p, s->Ap, m->nrow);
 
     const double alpha = rz / pAp;
 
-    for (int i = 0; i < m->nrow; ++i) x[i] += alpha * m->p[i];
+    for (int i = 0; i < m->nrow; ++i) x[i] += alpha * s->p[i];
 
-    for (int i = 0; i < m->nrow; ++i) m->r[i] -= alpha * m->Ap[i];
+    for (int i = 0; i < m->nrow; ++i) s->r[i] -= alpha * s->Ap[i];
 
-    for (int i = 0; i < m->nrow; ++i) m->z[i] = m->k[i] * m->r[i];
+    for (int i = 0; i < m->nrow; ++i) s->z[i] = s->k[i] * s->r[i];
 
-    pnorm = sqrt(get_dot(m->z, m->z, m->nrow));
+    pnorm = sqrt(get_dot(s->z, s->z, m->nrow));
 
-    double rz_n = get_dot(m->r, m->z, m->nrow);
+    double rz_n = get_dot(s->r, s->z, m->nrow);
 
     const double beta = rz_n / rz;
-    for (int i = 0; i < m->nrow; ++i) m->p[i] = m->z[i] + beta * m->p[i];
+    for (int i = 0; i < m->nrow; ++i) s->p[i] = s->z[i] + beta * s->p[i];
 
     rz = rz_n;
     its++;
@@ -118,5 +131,6 @@ int ell_solve_cgpd(const ell_matrix *m, const double *b, double *x, double *err)
 
   *err = rz;
 
+  INST_ITS(its);
   return its;
 }
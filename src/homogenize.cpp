@@ -63,39 +63,102 @@ void micropp<tdim>::homogenize_linear() {
 
     homogenize_linear(gp_ptr);
   }
+
+  mem_update_gp_state();
 }
 
 template <int tdim>
 void micropp<tdim>::homogenize() {
   INST_START;
 
-#pragma omp parallel for schedule(dynamic, 1)
-  for (int igp = 0; igp < ngp; ++igp) {
-    gp_t<tdim> *gp_ptr = &gp_list[igp];
-
-    if (gp_ptr->coupling == FE_LINEAR || gp_ptr->coupling == MIX_RULE_CHAMIS) {
-      /*
-       * Computational cheap calculation
-       * stress = ctan_lin * strain
-       *
-       * All mixture rules are linear in Micropp
-       * so the homogenization of the stress tensor
-       * is this simple and cheap procedure.
-       */
-
-      homogenize_linear(gp_ptr);
-
-    } else if (gp_ptr->coupling == FE_ONE_WAY) {
-      homogenize_fe_one_way(gp_ptr);
+  grow_solvers();
+
+  if (numa) {
+    /* Own block first, then the blocks of the next nodes */
+    memset(numa_next, 0, numa_nodes * sizeof(int));
+#pragma omp parallel
+    {
+      const int node = get_thread_node();
+      long local = 0, remote = 0;
+      for (int k = 0; k < numa_nodes; ++k) {
+        int igp;
+        while ((igp = numa_take_gp((node + k) % numa_nodes)) >= 0) {
+          if (spill_budget > 0) {
+            spill_begin(igp);
+          }
+          homogenize_gp(&gp_list[igp]);
+          if (spill_budget > 0) {
+            spill_end(igp);
+          }
+          if (k == 0) {
+            local++;
+          } else {
+            remote++;
+          }
+        }
+      }
+#pragma omp atomic
+      numa_local += local;
+#pragma omp atomic
+      numa_remote += remote;
+    }
 
-    } else if (gp_ptr->coupling == FE_FULL) {
-      homogenize_fe_full(gp_ptr);
+  } else {
+#pragma omp parallel for schedule(dynamic, 1)
+    for (int igp = 0; igp < ngp; ++igp) {
+      if (spill_budget > 0) {
+        spill_begin(igp);
+      }
+      homogenize_gp(&gp_list[igp]);
+      if (spill_budget > 0) {
+        spill_end(igp);
+      }
     }
   }
 
+  mem_update_gp_state();
+
   if (write_log_flag) {
     write_log();
   }
+
+  if (telemetry_log != TELEM_LOG_NONE) {
+    write_telemetry();
+  }
+}
+
+template <int tdim>
+void micropp<tdim>::homogenize_gp(gp_t<tdim> *gp_ptr) {
+  INST_START;
+  INST_GP(gp_ptr - gp_list);
+
+  memset(&gp_ptr->telem, 0, sizeof(gp_telemetry));
+  const double t_0 = wall_time();
+
+  if (gp_ptr->coupling == FE_LINEAR || gp_ptr->coupling == MIX_RULE_CHAMIS) {
+    /*
+     * Computational cheap calculation
+     * stress = ctan_lin * strain
+     *
+     * All mixture rules are linear in Micropp
+     * so the homogenization of the stress tensor
+     * is this simple and cheap procedure.
+     */
+
+    homogenize_linear(gp_ptr);
+
+  } else if (gp_ptr->coupling == FE_ONE_WAY) {
+    homogenize_fe_one_way(gp_ptr);
+
+  } else if (gp_ptr->coupling == FE_FULL) {
+    homogenize_fe_full(gp_ptr);
+  }
+
+  gp_ptr->telem.t_total = wall_time() - t_0;
+  gp_ptr->telem.substeps = gp_ptr->substeps;
+  gp_ptr->telem.substep_cuts = gp_ptr->substep_cuts;
+  gp_ptr->telem.converged = gp_ptr->converged;
+  gp_ptr->telem.bytes = get_gp_bytes(gp_ptr);
 }
 
 template <int tdim>
@@ -108,27 +171,351 @@ void micropp<tdim>::homogenize_linear(gp_t<tdim> *gp_ptr) {
   }
 }
 
+template <int tdim>
+void micropp<tdim>::calc_displ_affine(const double strain[nvoi], double *u) const {
+  /* u = eps . x on all the nodes, the values of set_displ_bc on the boundary */
+  const double eps_t[3][3] = {
+      {strain[0], 0.5 * ((dim == 3) ? strain[3] : strain[2]), (dim == 3) ? 0.5 * strain[4] : 0.0},
+      {0.5 * ((dim == 3) ? strain[3] : strain[2]), strain[1], (dim == 3) ? 0.5 * strain[5] : 0.0},
+      {(dim == 3) ? 0.5 * strain[4] : 0.0, (dim == 3) ? 0.5 * strain[5] : 0.0, (dim == 3) ? strain[2] : 0.0}};
+
+  for (int k = 0; k < nz; ++k) {
+    for (int j = 0; j < ny; ++j) {
+      for (int i = 0; i < nx; ++i) {
+        const int n = nod_index(i, j, k);
+        const double coor[3] = {i * dx, j * dy, k * dz};
+        for (int d = 0; d < dim; ++d) {
+          double tmp = 0.0;
+          for (int c = 0; c < dim; ++c) {
+            tmp += eps_t[d][c] * coor[c];
+          }
+          u[n * dim + d] = tmp;
+        }
+      }
+    }
+  }
+}
+
+template <int tdim>
+void micropp<tdim>::load_u(const gp_t<tdim> *gp_ptr, double *u, double *work, const bool last) const {
+  /* u_n (u_k if <last>) of the GP in <u>, <work> (nndim) is overwritten */
+  const cfield *uc = (last) ? &gp_ptr->uc_k : &gp_ptr->uc_n;
+  if (u_storage == U_PLAIN) {
+    memcpy(u, (last) ? gp_ptr->u_k : gp_ptr->u_n, nndim * sizeof(double));
+  } else if (uc->n == 0) {
+    memset(u, 0, nndim * sizeof(double));
+  } else {
+    calc_displ_affine((last) ? gp_ptr->strain_uc_k : gp_ptr->strain_uc_n, work);
+    cfield_unpack(uc, work, u);
+  }
+}
+
+template <int tdim>
+void micropp<tdim>::store_u(gp_t<tdim> *gp_ptr, const double *u, double *work) {
+  /* <u> as u_k of the GP, <work> (nndim) is overwritten */
+  if (u_storage == U_PLAIN) {
+    memcpy(gp_ptr->u_k, u, nndim * sizeof(double));
+  } else {
+    const double tol = (u_storage == U_LOSSY && !gp_ptr->allocated) ? u_lossy_tol : 0.0;
+    memcpy(gp_ptr->strain_uc_k, gp_ptr->strain, nvoi * sizeof(double));
+    calc_displ_affine(gp_ptr->strain_uc_k, work);
+    cfield_pack(&gp_ptr->uc_k, u, work, nndim, dim, tol);
+  }
+}
+
+template <int tdim>
+void micropp<tdim>::calc_displ_predictor(const double strain_old[nvoi], const double strain[nvoi], double *u) const {
+  /*
+   * Linearised predictor : u += sum_i (strain - strain_old)_i u_lin_i
+   * is the exact solution increment of the linear RVE, the interior
+   * fluctuations are extrapolated and not only the boundary values.
+   * It is not used for the D_EPS_CTAN_AVE perturbations of the tangent,
+   * their residual after the prediction can fall below nr_max_tol and
+   * the finite differences would give the elastic tangent.
+   */
+  for (int i = 0; i < nvoi; ++i) {
+    const double deps = strain[i] - strain_old[i];
+    if (deps == 0.0) continue;
+    const double *u_lin_i = &u_lin[i * nndim];
+    for (int j = 0; j < nndim; ++j) u[j] += deps * u_lin_i[j];
+  }
+}
+
+template <int tdim>
+newton_t micropp<tdim>::newton_substepping(gp_t<tdim> *gp_ptr, ell_matrix *A, double *b, double *u, double *du,
+                                           const bool inexact) {
+  INST_START;
+
+  /*
+   * Adaptive sub-stepping from <strain_old> to <strain> when the direct
+   * Newton-Raphson failed. The first sub-increment is 1 / nsubiterations
+   * of the total, it is doubled after a sub-step that converges in
+   * SUBSTEP_EASY_ITS iterations and halved (the sub-step is repeated)
+   * after a failure. Once SUBSTEP_MAX_CUTS halvings are spent the failed
+   * sub-steps are accepted with the initial sub-increment (as the fixed
+   * sub-iterations did) and the GP is reported as not converged. The
+   * jacobian of the last iteration is reused by the first one of the
+   * next sub-step.
+   */
+
+  newton_t newton_sub;
+  newton_sub.converged = true;
+
+  double *u_conv = get_work()->u_conv;
+  load_u(gp_ptr, u, u_conv);
+
+  const double dt_0 = 1.0 / nsubiterations;
+  double t = 0.0, dt = dt_0;
+  bool reuse_A = false;
+
+  double eps_conv[nvoi];
+  memcpy(eps_conv, gp_ptr->strain_old, nvoi * sizeof(double));
+
+  while (t < 1.0) {
+    /* The last sub-step ends on 1.0 : the rounding of the sums of dt would leave one of ~1e-16 */
+    const bool last = (t + dt > 1.0 - SUBSTEP_T_TOL);
+    if (last) {
+      dt = 1.0 - t;
+    }
+    const double t_next = (last) ? 1.0 : t + dt;
+
+    double eps_sub[nvoi];
+    for (int i = 0; i < nvoi; ++i) {
+      eps_sub[i] = gp_ptr->strain_old[i] + t_next * (gp_ptr->strain[i] - gp_ptr->strain_old[i]);
+    }
+
+    memcpy(u_conv, u, nndim * sizeof(double));
+    if (use_predictor) {
+      calc_displ_predictor(eps_conv, eps_sub, u);
+    }
+
+    newton_t newton = newton_raphson(A, b, u, du, eps_sub, gp_ptr->vars_n, inexact, reuse_A, &gp_ptr->telem);
+    newton_sub.its += newton.its;
+    newton_sub.solver_its += newton.solver_its;
+    memcpy(newton_sub.stress, newton.stress, nvoi * sizeof(double));
+
+    if (newton.converged || gp_ptr->substep_cuts >= SUBSTEP_MAX_CUTS) {
+      newton_sub.converged = newton_sub.converged && newton.converged;
+      gp_ptr->substeps++;
+      t = t_next;
+      memcpy(eps_conv, eps_sub, nvoi * sizeof(double));
+      if (!newton.converged) {
+        dt = dt_0;
+      } else if (newton.its <= SUBSTEP_EASY_ITS) {
+        dt *= 2.0;
+      }
+      reuse_A = newton.assembled;
+    } else {
+      gp_ptr->substep_cuts++;
+      memcpy(u, u_conv, nndim * sizeof(double));
+      dt *= 0.5;
+      reuse_A = false;
+    }
+  }
+
+  newton_sub.assembled = reuse_A;
+  return newton_sub;
+}
+
+template <int tdim>
+bool micropp<tdim>::load_jacobian(const gp_t<tdim> *gp_ptr, ell_matrix *A) const {
+  /*
+   * Modified Newton : the jacobian of the last time step starts the new
+   * one. Only for FE_ONE_WAY, the finite difference tangents of FE_FULL
+   * need the full Newton-Raphson.
+   */
+  if (gp_ptr->jac == nullptr) {
+    return false;
+  }
+  memcpy(A->vals, gp_ptr->jac, A->nrow * A->nnz * sizeof(double));
+  return true;
+}
+
+template <int tdim>
+void micropp<tdim>::keep_jacobian(gp_t<tdim> *gp_ptr, const ell_matrix *A) {
+  /*
+   * Only the non-linear GPs keep their jacobian, the first <jac_keep_max>
+   * of them to fit in nr_jac_mem. The columns are the same for all GPs.
+   */
+  if (!nr_modified || !gp_ptr->allocated) {
+    return;
+  }
+
+  if (gp_ptr->jac == nullptr) {
+    /* The count stays bounded : the GPs past jac_keep_max stop at the read */
+    int slot;
+#pragma omp atomic read
+    slot = jac_kept;
+    if (slot >= jac_keep_max) {
+      return;
+    }
+#pragma omp atomic capture
+    slot = jac_kept++;
+    if (slot >= jac_keep_max) {
+      return;
+    }
+    gp_ptr->jac = (double *)slab_alloc(&gp_slab, A->nrow * A->nnz * sizeof(double));
+  }
+  memcpy(gp_ptr->jac, A->vals, A->nrow * A->nnz * sizeof(double));
+}
+
+template <int tdim>
+long micropp<tdim>::get_gp_bytes(const gp_t<tdim> *gp_ptr) const {
+  long bytes = (gp_ptr->u_n != nullptr) ? 2 * nndim * sizeof(double) : 0;
+  if (gp_ptr->allocated) {
+    bytes += vars_get_bytes(gp_ptr->vars_n) + vars_get_bytes(gp_ptr->vars_k);
+  }
+  if (gp_ptr->jac != nullptr) {
+    bytes += (long)nndim * mypow(3, dim) * dim * sizeof(double);
+  }
+  return bytes;
+}
+
+template <int tdim>
+void micropp<tdim>::spill_gp(gp_t<tdim> *gp_ptr, const bool prefetch) {
+  /* Blocks of the GP in the slab to / from the spill files */
+  auto apply = [&](const void *ptr, const size_t bytes) {
+    if (prefetch) {
+      slab_prefetch(&gp_slab, ptr, bytes);
+    } else {
+      slab_evict(&gp_slab, ptr, bytes);
+    }
+  };
+
+  apply(gp_ptr->u_n, nndim * sizeof(double));
+  apply(gp_ptr->u_k, nndim * sizeof(double));
+  if (gp_ptr->allocated) {
+    const vars_map *maps[2] = {gp_ptr->vars_n, gp_ptr->vars_k};
+    for (const vars_map *m : maps) {
+      apply(m->off, nelem * sizeof(long));
+      apply(m->vals, m->capacity * sizeof(double));
+    }
+  }
+  apply(gp_ptr->jac, (size_t)nndim * mypow(3, dim) * dim * sizeof(double));
+}
+
+template <int tdim>
+void micropp<tdim>::lru_remove(const int igp) {
+  gp_t<tdim> *gp_ptr = &gp_list[igp];
+  if (gp_ptr->lru_prev < 0 && lru_head != igp) {
+    return;  // not in the list
+  }
+  if (gp_ptr->lru_prev >= 0) {
+    gp_list[gp_ptr->lru_prev].lru_next = gp_ptr->lru_next;
+  } else {
+    lru_head = gp_ptr->lru_next;
+  }
+  if (gp_ptr->lru_next >= 0) {
+    gp_list[gp_ptr->lru_next].lru_prev = gp_ptr->lru_prev;
+  } else {
+    lru_tail = gp_ptr->lru_prev;
+  }
+  gp_ptr->lru_prev = -1;
+  gp_ptr->lru_next = -1;
+}
+
+template <int tdim>
+void micropp<tdim>::lru_append(const int igp) {
+  gp_list[igp].lru_prev = lru_tail;
+  gp_list[igp].lru_next = -1;
+  if (lru_tail >= 0) {
+    gp_list[lru_tail].lru_next = igp;
+  } else {
+    lru_head = igp;
+  }
+  lru_tail = igp;
+}
+
+template <int tdim>
+void micropp<tdim>::spill_begin(const int igp) {
+  /*
+   * The GP leaves the LRU list while it is homogenized. With
+   * schedule(dynamic, 1) each thread takes about the num_solvers-th next
+   * GP, it is prefetched if it was written back.
+   */
+  const int inext = igp + num_solvers;
+  bool prefetch;
+
+#pragma omp critical(spill)
+  {
+    gp_list[igp].busy = true;
+    lru_remove(igp);
+    prefetch = (inext < ngp && gp_list[inext].spilled);
+  }
+
+  if (prefetch) {
+    spill_gp(&gp_list[inext], true);
+  }
+}
+
+template <int tdim>
+void micropp<tdim>::spill_end(const int igp) {
+  /*
+   * LRU : the GP goes back to the budget with its new size, at the tail
+   * of the list, and the GPs at the head are written back while the
+   * budget is passed. They are taken under the lock and written outside.
+   */
+  gp_t<tdim> *gp_ptr = &gp_list[igp];
+  const long bytes = get_gp_bytes(gp_ptr);
+  vector<int> victims;
+
+#pragma omp critical(spill)
+  {
+    spill_resident += bytes - ((gp_ptr->spilled) ? 0 : gp_ptr->spill_bytes);
+    gp_ptr->spill_bytes = bytes;
+    gp_ptr->spilled = false;
+    gp_ptr->busy = false;
+    if (bytes > 0) {
+      lru_append(igp);
+    }
+
+    while (spill_resident > spill_budget && lru_head >= 0) {
+      const int lru = lru_head;
+      lru_remove(lru);
+      gp_list[lru].spilled = true;
+      spill_resident -= gp_list[lru].spill_bytes;
+      spill_outs++;
+      victims.push_back(lru);
+    }
+  }
+
+  for (const int i : victims) {
+    spill_gp(&gp_list[i], false);
+  }
+}
+
 template <int tdim>
 void micropp<tdim>::homogenize_fe_one_way(gp_t<tdim> *gp_ptr) {
-  ell_matrix A;  // Jacobian
-  const int ns[3] = {nx, ny, nz};
-  ell_init(&A, dim, dim, ns, CG_ABS_TOL, CG_REL_TOL, CG_MAX_ITS);
-  double *b = (double *)calloc(nndim, sizeof(double));
-  double *du = (double *)calloc(nndim, sizeof(double));
-  double *u = (double *)calloc(nndim, sizeof(double));
-  double *vars_new_aux = (double *)calloc(nvars, sizeof(double));
+  /* Scratch of the thread, as clean as a new one */
+  gp_work *work = get_work();
+  ell_matrix *A = &work->A;  // Jacobian
+  double *b = work->b;
+  double *du = work->du;
+  double *u = work->u;
+  memset(b, 0, nndim * sizeof(double));
+  memset(du, 0, nndim * sizeof(double));
+  memset(u, 0, nndim * sizeof(double));
+  if (!gp_ptr->allocated) {
+    vars_clear(&work->vars_aux);
+  }
+  const long aux_bytes = vars_get_bytes(&work->vars_aux);
 
-  double *vars_new = (gp_ptr->allocated) ? gp_ptr->vars_k : vars_new_aux;
+  vars_map *vars_new = (gp_ptr->allocated) ? gp_ptr->vars_k : &work->vars_aux;
 
   gp_ptr->cost = 0;
   gp_ptr->subiterated = false;
+  gp_ptr->substeps = 0;
+  gp_ptr->substep_cuts = 0;
 
   // SIGMA 1 Newton-Raphson
-  memcpy(u, gp_ptr->u_n, nndim * sizeof(double));
+  load_u(gp_ptr, u, b);
+  if (use_predictor) {
+    calc_displ_predictor(gp_ptr->strain_old, gp_ptr->strain, u);
+  }
 
-  newton_t newton = newton_raphson(&A, b, u, du, gp_ptr->strain, gp_ptr->vars_n);
+  const bool reuse_A = load_jacobian(gp_ptr, A);
+  newton_t newton = newton_raphson(A, b, u, du, gp_ptr->strain, gp_ptr->vars_n, true, reuse_A, &gp_ptr->telem);
 
-  memcpy(gp_ptr->u_k, u, nndim * sizeof(double));
   gp_ptr->cost += newton.solver_its;
   gp_ptr->converged = newton.converged;
 
@@ -136,24 +523,12 @@ void micropp<tdim>::homogenize_fe_one_way(gp_t<tdim> *gp_ptr) {
    * In case it has not converged do the sub-iterations
    */
   if (gp_ptr->converged == false && subiterations == true) {
-    double eps_sub[nvoi], deps_sub[nvoi];
-    memcpy(u, gp_ptr->u_n, nndim * sizeof(double));
-    memcpy(eps_sub, gp_ptr->strain_old, nvoi * sizeof(double));
     gp_ptr->subiterated = true;
 
-    for (int i = 0; i < nvoi; ++i) deps_sub[i] = (gp_ptr->strain[i] - gp_ptr->strain_old[i]) / nsubiterations;
-
-    for (int its = 0; its < nsubiterations; ++its) {
-      for (int j = 0; j < nvoi; ++j) {
-        eps_sub[j] += deps_sub[j];
-      }
-
-      newton = newton_raphson(&A, b, u, du, eps_sub, gp_ptr->vars_n);
-      gp_ptr->cost += newton.solver_its;
-    }
+    newton = newton_substepping(gp_ptr, A, b, u, du, true);
+    gp_ptr->cost += newton.solver_its;
 
     gp_ptr->converged = newton.converged;
-    memcpy(gp_ptr->u_k, u, nndim * sizeof(double));
   }
 
   if (lin_stress) {
@@ -165,47 +540,61 @@ void micropp<tdim>::homogenize_fe_one_way(gp_t<tdim> *gp_ptr) {
     }
 
   } else {
-    calc_ave_stress(gp_ptr->u_k, gp_ptr->stress, gp_ptr->vars_n);
+    /* Stresses of the last residual, no new pass over the elements */
+    memcpy(gp_ptr->stress, newton.stress, nvoi * sizeof(double));
   }
 
   // Updates <vars_new>
-  bool non_linear = calc_vars_new(gp_ptr->u_k, gp_ptr->vars_n, vars_new);
+  const double t_mat = wall_time();
+  bool non_linear = calc_vars_new(u, gp_ptr->vars_n, vars_new);
+  gp_ptr->telem.t_material += wall_time() - t_mat;
+  mem_add(MEM_WORKSPACES, vars_get_bytes(&work->vars_aux) - aux_bytes);  // kept for the next GPs
 
   if (non_linear == true) {
     if (gp_ptr->allocated == false) {
       gp_ptr->allocate();
-      memcpy(gp_ptr->vars_k, vars_new, nvars * sizeof(double));
+      vars_copy(gp_ptr->vars_k, vars_new);
     }
   }
 
-  ell_free(&A);
-  free(b);
-  free(u);
-  free(du);
-  free(vars_new_aux);
+  store_u(gp_ptr, u, b);
+
+  if (newton.assembled) {
+    keep_jacobian(gp_ptr, A);
+  }
 }
 
 template <int tdim>
 void micropp<tdim>::homogenize_fe_full(gp_t<tdim> *gp_ptr) {
-  ell_matrix A;  // Jacobian
-  const int ns[3] = {nx, ny, nz};
-  ell_init(&A, dim, dim, ns, CG_ABS_TOL, CG_REL_TOL, CG_MAX_ITS);
-  double *b = (double *)calloc(nndim, sizeof(double));
-  double *du = (double *)calloc(nndim, sizeof(double));
-  double *u = (double *)calloc(nndim, sizeof(double));
-  double *vars_new_aux = (double *)calloc(nvars, sizeof(double));
+  /* Scratch of the thread, as clean as a new one */
+  gp_work *work = get_work();
+  ell_matrix *A = &work->A;  // Jacobian
+  double *b = work->b;
+  double *du = work->du;
+  double *u = work->u;
+  memset(b, 0, nndim * sizeof(double));
+  memset(du, 0, nndim * sizeof(double));
+  memset(u, 0, nndim * sizeof(double));
+  if (!gp_ptr->allocated) {
+    vars_clear(&work->vars_aux);
+  }
+  const long aux_bytes = vars_get_bytes(&work->vars_aux);
 
-  double *vars_new = (gp_ptr->allocated) ? gp_ptr->vars_k : vars_new_aux;
+  vars_map *vars_new = (gp_ptr->allocated) ? gp_ptr->vars_k : &work->vars_aux;
 
   gp_ptr->cost = 0;
   gp_ptr->subiterated = false;
+  gp_ptr->substeps = 0;
+  gp_ptr->substep_cuts = 0;
 
   // SIGMA 1 Newton-Raphson
-  memcpy(u, gp_ptr->u_n, nndim * sizeof(double));
+  load_u(gp_ptr, u, b);
+  if (use_predictor) {
+    calc_displ_predictor(gp_ptr->strain_old, gp_ptr->strain, u);
+  }
 
-  newton_t newton = newton_raphson(&A, b, u, du, gp_ptr->strain, gp_ptr->vars_n);
+  newton_t newton = newton_raphson(A, b, u, du, gp_ptr->strain, gp_ptr->vars_n, false, false, &gp_ptr->telem);
 
-  memcpy(gp_ptr->u_k, u, nndim * sizeof(double));
   gp_ptr->cost += newton.solver_its;
   gp_ptr->converged = newton.converged;
 
@@ -213,22 +602,12 @@ void micropp<tdim>::homogenize_fe_full(gp_t<tdim> *gp_ptr) {
    * In case it has not converged do the sub-iterations
    */
   if (gp_ptr->converged == false && subiterations == true) {
-    double eps_sub[nvoi], deps_sub[nvoi];
-    memcpy(u, gp_ptr->u_n, nndim * sizeof(double));
-    memcpy(eps_sub, gp_ptr->strain_old, nvoi * sizeof(double));
     gp_ptr->subiterated = true;
 
-    for (int i = 0; i < nvoi; ++i) deps_sub[i] = (gp_ptr->strain[i] - gp_ptr->strain_old[i]) / nsubiterations;
-
-    for (int its = 0; its < nsubiterations; ++its) {
-      for (int j = 0; j < nvoi; ++j) eps_sub[j] += deps_sub[j];
-
-      newton = newton_raphson(&A, b, u, du, eps_sub, gp_ptr->vars_n);
-      gp_ptr->cost += newton.solver_its;
-    }
+    newton = newton_substepping(gp_ptr, A, b, u, du, false);
+    gp_ptr->cost += newton.solver_its;
 
     gp_ptr->converged = newton.converged;
-    memcpy(gp_ptr->u_k, u, nndim * sizeof(double));
   }
 
   if (lin_stress) {
@@ -240,45 +619,45 @@ void micropp<tdim>::homogenize_fe_full(gp_t<tdim> *gp_ptr) {
     }
 
   } else {
-    calc_ave_stress(gp_ptr->u_k, gp_ptr->stress, gp_ptr->vars_n);
+    /* Stresses of the last residual, no new pass over the elements */
+    memcpy(gp_ptr->stress, newton.stress, nvoi * sizeof(double));
   }
 
   // Updates <vars_new>
-  bool non_linear = calc_vars_new(gp_ptr->u_k, gp_ptr->vars_n, vars_new);
+  const double t_mat = wall_time();
+  bool non_linear = calc_vars_new(u, gp_ptr->vars_n, vars_new);
+  gp_ptr->telem.t_material += wall_time() - t_mat;
+  mem_add(MEM_WORKSPACES, vars_get_bytes(&work->vars_aux) - aux_bytes);  // kept for the next GPs
 
   if (non_linear == true) {
     if (gp_ptr->allocated == false) {
       gp_ptr->allocate();
-      memcpy(gp_ptr->vars_k, vars_new, nvars * sizeof(double));
+      vars_copy(gp_ptr->vars_k, vars_new);
     }
   }
 
+  store_u(gp_ptr, u, b);
+
   if (gp_ptr->allocated) {
     // CTAN 3/6 Newton-Raphsons in 2D/3D
     double eps_1[6], sig_0[6], sig_1[6];
 
-    memcpy(u, gp_ptr->u_k, nndim * sizeof(double));
+    /* <u> still holds the solution (exact with any u_storage) */
     memcpy(sig_0, gp_ptr->stress, nvoi * sizeof(double));
 
     for (int i = 0; i < nvoi; ++i) {
       memcpy(eps_1, gp_ptr->strain, nvoi * sizeof(double));
       eps_1[i] += D_EPS_CTAN_AVE;
 
-      newton_raphson(&A, b, u, du, eps_1, gp_ptr->vars_n);
+      newton = newton_raphson(A, b, u, du, eps_1, gp_ptr->vars_n, false, false, &gp_ptr->telem);
 
       gp_ptr->cost += newton.solver_its;
 
-      calc_ave_stress(u, sig_1, gp_ptr->vars_n);
+      memcpy(sig_1, newton.stress, nvoi * sizeof(double));
 
       for (int v = 0; v < nvoi; ++v) gp_ptr->ctan[v * nvoi + i] = (sig_1[v] - sig_0[v]) / D_EPS_CTAN_AVE;
     }
   }
-
-  ell_free(&A);
-  free(b);
-  free(u);
-  free(du);
-  free(vars_new_aux);
 }
 
 template <int tdim>
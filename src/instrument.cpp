@@ -25,42 +25,352 @@
 
 #include "instrument.hpp"
 
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
 #include <iomanip>  // std::setw
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
 
 using namespace std;
 
 atomic<size_t> instrument::instances(0);
 uint64_t instrument::initialTime(0);
-unordered_map<string, timevect> instrument::times;  // Final register time
+bool instrument::counting(false);
+
+/* Timings of one thread */
+typedef struct {
+  inst_stats stats[INST_MAX_REGIONS];
+  inst_event *ring;  // last INST_TRACE_EVENTS events, nullptr without trace
+  uint64_t nevents;
+  int tid;                        // order of the first timing
+  int perf_fd;                    // leader of the counter group, -1 : no counters, -2 : not opened yet
+  int perf_fds[INST_NCOUNTERS];   // all the counters, -1 : not available
+  int perf_slot[INST_NCOUNTERS];  // place of the counters in the group, -1 : not available
+
+} inst_thread;
+
+/* Region names and the tables of all the threads, only touched to register */
+static mutex inst_mutex;
+static vector<string> inst_names;
+static vector<inst_thread *> inst_tables;
+static const char *inst_trace = nullptr;  // MICROPP_TRACE
+static atomic<bool> inst_counter_ok[INST_NCOUNTERS];  // set by the threads that open the counter
+
+/* Table of the thread, allocated again after finalize() freed the tables of generation inst_table_gen */
+static atomic<int> inst_generation(0);
+static thread_local inst_thread *inst_table = nullptr;
+static thread_local int inst_table_gen = -1;
+
+static void inst_reset(inst_thread *table) {
+  memset(table->stats, 0, INST_MAX_REGIONS * sizeof(inst_stats));
+  for (int r = 0; r < INST_MAX_REGIONS; ++r) table->stats[r].min = UINT64_MAX;
+  table->nevents = 0;
+}
+
+int instrument::region(const char *name) {
+  lock_guard<mutex> lock(inst_mutex);
+  for (int r = 0; r < (int)inst_names.size(); ++r) {
+    if (inst_names[r] == name) {
+      return r;
+    }
+  }
+  if ((int)inst_names.size() == INST_MAX_REGIONS - 1) {
+    inst_names.push_back("(others)");
+  }
+  if ((int)inst_names.size() == INST_MAX_REGIONS) {
+    return INST_MAX_REGIONS - 1;
+  }
+  inst_names.push_back(name);
+  return (int)inst_names.size() - 1;
+}
+
+static void inst_open_counters(inst_thread *table) {
+  /* One group per thread (user space only), the counters that do not open are left out */
+  uint64_t configs[INST_NCOUNTERS][2] = {{PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+                                         {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+                                         {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+                                         {PERF_TYPE_RAW, 0}};
+  const char *fp_event = getenv("MICROPP_FP_EVENT");
+  if (fp_event != nullptr) {
+    configs[INST_FP_OPS][1] = strtoull(fp_event, nullptr, 16);
+  }
+
+  table->perf_fd = -1;
+  int nslots = 0;
+  for (int c = 0; c < INST_NCOUNTERS; ++c) {
+    table->perf_fds[c] = -1;
+    table->perf_slot[c] = -1;
+    if (c == INST_FP_OPS && fp_event == nullptr) {
+      continue;
+    }
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = configs[c][0];
+    attr.config = configs[c][1];
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    const int fd = syscall(SYS_perf_event_open, &attr, 0, -1, table->perf_fd, 0);
+    if (fd >= 0) {
+      if (table->perf_fd < 0) {
+        table->perf_fd = fd;
+      }
+      table->perf_fds[c] = fd;
+      table->perf_slot[c] = nslots++;
+      inst_counter_ok[c] = true;
+    }
+  }
+}
+
+static inst_thread *inst_get_table() {
+  if (inst_table == nullptr || inst_table_gen != inst_generation) {
+    /* First timing of this thread, own cache lines */
+    inst_table = nullptr;
+    void *ptr = nullptr;
+    if (posix_memalign(&ptr, 64, sizeof(inst_thread))) {
+      return nullptr;
+    }
+    inst_table = (inst_thread *)ptr;
+    inst_table_gen = inst_generation;
+    inst_table->ring = nullptr;
+    inst_table->perf_fd = -2;
+    inst_reset(inst_table);
+    lock_guard<mutex> lock(inst_mutex);
+    inst_table->tid = (int)inst_tables.size();
+    inst_tables.push_back(inst_table);
+  }
+  return inst_table;
+}
+
+void instrument::read_counters(uint64_t counts[INST_NREADS]) {
+  /* Group read : #counters, time enabled, time running and the counters */
+  uint64_t values[3 + INST_NCOUNTERS];
+  inst_thread *table = inst_get_table();
+  if (table != nullptr && table->perf_fd == -2) {
+    inst_open_counters(table);
+  }
+  if (table == nullptr || table->perf_fd < 0 || read(table->perf_fd, values, sizeof(values)) <= 0) {
+    memset(counts, 0, INST_NREADS * sizeof(uint64_t));
+    return;
+  }
+  for (int c = 0; c < INST_NCOUNTERS; ++c) counts[c] = (table->perf_slot[c] >= 0) ? values[3 + table->perf_slot[c]] : 0;
+  counts[INST_NCOUNTERS] = values[1];
+  counts[INST_NCOUNTERS + 1] = values[2];
+}
+
+void instrument::record(const instrument *inst, const uint64_t elapsed) {
+  uint64_t counts[INST_NREADS];
+  if (counting) {
+    read_counters(counts);
+  }
+
+  if (inst_get_table() == nullptr) {
+    return;
+  }
+
+  if (inst_trace != nullptr) {
+    if (inst_table->ring == nullptr) {
+      inst_table->ring = (inst_event *)malloc(INST_TRACE_EVENTS * sizeof(inst_event));
+    }
+    if (inst_table->ring != nullptr) {
+      inst_event *event = &inst_table->ring[inst_table->nevents % INST_TRACE_EVENTS];
+      event->start = inst->start_time_ - initialTime;
+      event->dur = elapsed;
+      event->region = inst->region_;
+      event->gp = inst->gp_;
+      event->its = inst->its_;
+      inst_table->nevents++;
+    }
+  }
+
+  inst_stats *stats = &inst_table->stats[inst->region_];
+  stats->count++;
+  stats->sum += elapsed;
+  stats->sum2 += (double)elapsed * elapsed;
+  stats->min = (elapsed < stats->min) ? elapsed : stats->min;
+  stats->max = (elapsed > stats->max) ? elapsed : stats->max;
+  const int bin = (elapsed > 0) ? 63 - __builtin_clzll(elapsed) : 0;
+  stats->hist[(bin < INST_HIST_BINS) ? bin : INST_HIST_BINS - 1]++;
+  if (counting) {
+    /* Multiplexed group : the counts of the time it ran extrapolated to the region */
+    const uint64_t enabled = counts[INST_NCOUNTERS] - inst->start_counts_[INST_NCOUNTERS];
+    const uint64_t running = counts[INST_NCOUNTERS + 1] - inst->start_counts_[INST_NCOUNTERS + 1];
+    const double scale = (running > 0) ? double(enabled) / running : 0.0;
+    for (int c = 0; c < INST_NCOUNTERS; ++c) stats->counts[c] += uint64_t((counts[c] - inst->start_counts_[c]) * scale);
+  }
+}
 
 void instrument::initialize() {
-  if (!instances++) initialTime = take_time_stamp();
+  if (!instances++) {
+    initialTime = take_time_stamp();
+    inst_trace = getenv("MICROPP_TRACE");
+    const char *counters = getenv("MICROPP_COUNTERS");
+    counting = (counters != nullptr && atoi(counters) > 0);
+  }
+}
+
+void instrument::trace_dump(const char *filename) {
+  /*
+   * Complete events ("ph" : "X") in us, one track per thread and one
+   * process per pid so the files of the MPI ranks can be merged
+   */
+  lock_guard<mutex> lock(inst_mutex);
+
+  ofstream file(filename);
+  const int pid = getpid();
+  file << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n";
+  file << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":" << pid << ",\"args\":{\"name\":\"micropp " << pid
+       << "\"}}";
+  file << fixed << setprecision(3);
+  for (const inst_thread *table : inst_tables) {
+    file << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" << pid << ",\"tid\":" << table->tid
+         << ",\"args\":{\"name\":\"thread " << table->tid << "\"}}";
+    if (table->ring == nullptr) {
+      continue;
+    }
+    const uint64_t first = (table->nevents > INST_TRACE_EVENTS) ? table->nevents - INST_TRACE_EVENTS : 0;
+    for (uint64_t i = first; i < table->nevents; ++i) {
+      const inst_event *event = &table->ring[i % INST_TRACE_EVENTS];
+      file << ",\n{\"name\":\"" << inst_names[event->region] << "\",\"ph\":\"X\",\"pid\":" << pid
+           << ",\"tid\":" << table->tid << ",\"ts\":" << event->start * 1E-3 << ",\"dur\":" << event->dur * 1E-3;
+      if (event->gp >= 0 || event->its >= 0) {
+        file << ",\"args\":{";
+        if (event->gp >= 0) {
+          file << "\"gp\":" << event->gp << ((event->its >= 0) ? "," : "");
+        }
+        if (event->its >= 0) {
+          file << "\"its\":" << event->its;
+        }
+        file << "}";
+      }
+      file << "}";
+    }
+  }
+  file << "\n]}\n";
 }
 
 void instrument::finalize() {
   if (0 == --instances) {
     const uint64_t elapsed = (take_time_stamp() - initialTime) * 1E-3;
 
+    /* <name>-<pid>.json, <name>-<pid>-<n>.json for the next runs of the process */
+    if (inst_trace != nullptr) {
+      static int ntraces = 0;
+      stringstream filename;
+      filename << inst_trace << "-" << getpid();
+      if (ntraces++ > 0) {
+        filename << "-" << ntraces - 1;
+      }
+      filename << ".json";
+      trace_dump(filename.str().c_str());
+    }
+
+    lock_guard<mutex> lock(inst_mutex);
+
+    /* Merge of the tables of all the threads */
+    vector<inst_stats> total(inst_names.size());
+    for (int r = 0; r < (int)total.size(); ++r) {
+      inst_stats *sum = &total[r];
+      memset(sum, 0, sizeof(inst_stats));
+      sum->min = UINT64_MAX;
+      for (const inst_thread *table : inst_tables) {
+        const inst_stats *stats = &table->stats[r];
+        sum->count += stats->count;
+        sum->sum += stats->sum;
+        sum->sum2 += stats->sum2;
+        sum->min = (stats->min < sum->min) ? stats->min : sum->min;
+        sum->max = (stats->max > sum->max) ? stats->max : sum->max;
+        for (int b = 0; b < INST_HIST_BINS; ++b) sum->hist[b] += stats->hist[b];
+        for (int c = 0; c < INST_NCOUNTERS; ++c) sum->counts[c] += stats->counts[c];
+      }
+    }
+
+    /* Times in us, p99 is the upper bound of its histogram bin */
     size_t cont = 0;
     cout << "# Final execution report: total time = " << elapsed << endl;
-    cout << setw(6) << left << "#No" << setw(25) << "function" << setw(8) << right << "calls" << setw(16)
-         << "total time" << setw(16) << "percent" << setw(16) << "mean" << setw(16) << "stdev" << setw(16) << "relative"
-         << endl;
+    cout << setw(6) << left << "#No" << setw(25) << "function" << setw(10) << right << "calls" << setw(16)
+         << "total time" << setw(10) << "percent" << setw(14) << "mean" << setw(14) << "stdev" << setw(14) << "min"
+         << setw(14) << "max" << setw(14) << "p99";
+    if (counting) {
+      cout << setw(10) << "IPC" << setw(10) << "GB/s" << setw(10) << "GFLOP/s";
+    }
+    cout << endl;
+
+    if (counting && !inst_counter_ok[INST_CYCLES] && !inst_counter_ok[INST_INSTRUCTIONS] &&
+        !inst_counter_ok[INST_LLC_MISSES] && !inst_counter_ok[INST_FP_OPS]) {
+      cout << "# No hardware counters (perf_event_paranoid, virtual machine or no PMU)" << endl;
+    }
 
     cout.precision(2);
     cout << fixed;
 
-    for (auto const &f : times) {
-      const uint64_t total = accumulate(f.second.begin(), f.second.end(), 0.0);
-      const size_t entries = f.second.size();
-      const uint64_t mean = total / entries;
-      const double percent = double(total) * 100 / elapsed;
-      const uint64_t stdev = devest(f.second, mean);
-      const double relative = double(stdev) * 100 / mean;
+    for (int r = 0; r < (int)total.size(); ++r) {
+      const inst_stats *stats = &total[r];
+      if (stats->count == 0) {
+        continue;
+      }
+      const double mean = double(stats->sum) / stats->count;
+      const double var = stats->sum2 / stats->count - mean * mean;
+      const double stdev = (var > 0.0) ? sqrt(var) : 0.0;
+
+      uint64_t below = 0;
+      int b99 = 0;
+      while (b99 < INST_HIST_BINS - 1 && (below += stats->hist[b99]) < 0.99 * stats->count) b99++;
+      const double p99 = min(2.0 * (1ull << b99), double(stats->max));
+
+      cout << setw(6) << left << cont++ << setw(25) << inst_names[r] << setw(10) << right << stats->count << setw(16)
+           << stats->sum * 1E-3 << setw(10) << stats->sum * 1E-1 / elapsed << setw(14) << mean * 1E-3 << setw(14)
+           << stdev * 1E-3 << setw(14) << stats->min * 1E-3 << setw(14) << stats->max * 1E-3 << setw(14)
+           << p99 * 1E-3;
+
+      if (counting) {
+        /* Per ns : GB/s and GFLOP/s */
+        auto ratio = [](const bool ok, const double num, const double den) {
+          stringstream ss;
+          ss << fixed << setprecision(2);
+          if (ok && den > 0.0) {
+            ss << num / den;
+          } else {
+            ss << "-";
+          }
+          return ss.str();
+        };
+        const uint64_t *counts = stats->counts;
+        cout << setw(10)
+             << ratio(inst_counter_ok[INST_CYCLES] && inst_counter_ok[INST_INSTRUCTIONS],
+                      double(counts[INST_INSTRUCTIONS]), double(counts[INST_CYCLES]))
+             << setw(10) << ratio(inst_counter_ok[INST_LLC_MISSES], 64.0 * counts[INST_LLC_MISSES], double(stats->sum))
+             << setw(10) << ratio(inst_counter_ok[INST_FP_OPS], double(counts[INST_FP_OPS]), double(stats->sum));
+      }
+      cout << endl;
+    }
 
-      cout << setw(6) << left << cont++ << setw(25) << f.first << setw(8) << right << entries << setw(16) << total
-           << setw(16) << percent << setw(16) << mean << setw(16) << stdev << setw(16) << relative << endl;
+    /* The threads allocate their tables and open their counters again at their next timing */
+    for (inst_thread *table : inst_tables) {
+      if (table->perf_fd >= 0) {
+        for (int c = 0; c < INST_NCOUNTERS; ++c) {
+          if (table->perf_fds[c] >= 0) {
+            close(table->perf_fds[c]);
+          }
+        }
+      }
+      free(table->ring);
+      free(table);
     }
+    inst_tables.clear();
+    for (int c = 0; c < INST_NCOUNTERS; ++c) inst_counter_ok[c] = false;
+    inst_generation++;
   }
 }
 
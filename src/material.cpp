@@ -46,9 +46,13 @@ material_t *material_t::make_material(const struct material_base material) {
 }
 
 CUDA_HOSTDEV
-void material_t::apply_perturbation(const double *eps, double *ctan, const double *vars_old) const {
-  double stress_0[6];
-  get_stress(eps, stress_0, vars_old);
+void material_t::apply_perturbation(const double *eps, double *ctan, const double *vars_old,
+                                    const double *stress_0) const {
+  double stress_0_aux[6];
+  if (stress_0 == nullptr) {
+    get_stress(eps, stress_0_aux, vars_old);
+    stress_0 = stress_0_aux;
+  }
 
   for (int i = 0; i < 6; ++i) {
     double eps_1[6];
@@ -62,6 +66,12 @@ void material_t::apply_perturbation(const double *eps, double *ctan, const doubl
   }
 }
 
+CUDA_HOSTDEV
+void material_t::get_stress_ctan(const double *eps, double *stress, double *ctan, const double *vars_old) const {
+  get_stress(eps, stress, vars_old);
+  apply_perturbation(eps, ctan, vars_old, stress);
+}
+
 CUDA_HOSTDEV
 void get_dev_tensor(const double tensor[6], double tensor_dev[6]) {
   memcpy(tensor_dev, tensor, 6 * sizeof(double));
@@ -72,6 +82,8 @@ void get_dev_tensor(const double tensor[6], double tensor_dev[6]) {
 
 void material_elastic::init_vars(double *vars_old) const {}
 
+int material_elastic::get_nvars() const { return 0; }
+
 CUDA_HOSTDEV
 void material_elastic::get_stress(const double *eps, double *stress, const double *history_params) const {
   // stress[i][j] = lambda eps[k][k] * delta[i][j] + mu eps[i][j]
@@ -93,6 +105,13 @@ void material_elastic::get_ctan(const double *eps, double *ctan, const double *h
   for (int i = 3; i < 6; ++i) ctan[i * 6 + i] = mu;
 }
 
+CUDA_HOSTDEV
+void material_elastic::get_stress_ctan(const double *eps, double *stress, double *ctan,
+                                       const double *history_params) const {
+  get_stress(eps, stress, history_params);
+  get_ctan(eps, ctan, history_params);
+}
+
 bool material_elastic::evolute(const double *eps, const double *vars_old, double *vars_new) const {
   // we don't have to evolute nothing is always linear
   return false;
@@ -107,6 +126,8 @@ void material_elastic::print() const {
 
 void material_plastic::init_vars(double *vars_old) const {}
 
+int material_plastic::get_nvars() const { return NUM_VAR_PLASTIC; }
+
 CUDA_HOSTDEV
 bool material_plastic::plastic_law(const double eps[6], const double *_eps_p_old, const double *_alpha_old, double *_dl,
                                    double _normal[6], double _s_trial[6]) const {
@@ -202,6 +223,8 @@ void material_damage::init_vars(double *vars_old) const {
   }
 }
 
+int material_damage::get_nvars() const { return NUM_VAR_DAMAGE; }
+
 CUDA_HOSTDEV
 double material_damage::hardening_law(const double r) const {
   const double Ey = 10.0e4;
@@ -23,6 +23,10 @@
 
 #include "micropp.hpp"
 
+#include <linux/magic.h>
+#include <sys/vfs.h>
+#include <unistd.h>
+
 #include "material.hpp"
 // #include "common.hpp"
 
@@ -59,19 +63,64 @@ micropp<tdim>::micropp(const micropp_params_t &params)
       ivol(1.0 / (wg * npe)),
       evol((tdim == 3) ? dx * dy * dz : dx * dy),
       micro_type(params.type),
-      nvars(nelem * npe * NUM_VAR_GP),
+      numa(params.numa),
+      numa_nodes(1),
+      thread_node(nullptr),
+      numa_first(nullptr),
+      numa_next(nullptr),
+      A0_node(nullptr),
+      elem_type_node(nullptr),
+      numa_local(0),
+      numa_remote(0),
 
       nr_max_its(params.nr_max_its),
       nr_max_tol(params.nr_max_tol),
       nr_rel_tol(params.nr_rel_tol),
       calc_ctan_lin_flag(params.calc_ctan_lin),
+      lin_stress(params.lin_stress),
 
       use_A0(params.use_A0),
       its_with_A0(params.its_with_A0),
-      lin_stress(params.lin_stress),
+      use_A0_chol(params.use_A0 && params.use_A0_chol),
+      use_defl(params.cg_defl_blocks > 0),
+      cg_warm_start(params.cg_warm_start),
+      cg_forcing(params.cg_forcing),
+      cg_forcing_max(params.cg_forcing_max),
+      cg_forcing_gamma(params.cg_forcing_gamma),
+      cg_forcing_alpha(params.cg_forcing_alpha),
+      use_predictor(params.use_predictor),
+      u_lin(nullptr),
+      nr_modified(params.nr_modified),
+      nr_modified_rate(params.nr_modified_rate),
+      nr_bfgs(params.nr_modified && params.nr_bfgs),
+      jac_keep_max(0),
+      jac_kept(0),
+      spill_budget((long)params.spill_mem * 1024 * 1024),
+      lru_head(-1),
+      lru_tail(-1),
+      spill_resident(0),
+      spill_outs(0),
+      u_storage(params.u_storage),
+      u_lossy_tol(params.u_lossy_tol),
+      restart_full_every(params.restart_full_every),
+      restart_seq(0),
+      restart_full_bytes(0),
+      restart_delta_bytes(0),
+      output_busy(0),
+      output_stop(false),
+      output_vtm(params.output_vtm),
+      telemetry_log(params.telemetry_log),
+      vtu_format(params.vtu_format),
+      vti_output(params.vti_output),
       write_log_flag(params.write_log) {
   INST_CONSTRUCT;  // Initialize the Intrumentation
 
+  for (int c = 0; c < MEM_NCATS; ++c) {
+    mem_current[c] = 0;
+    mem_peak[c] = 0;
+  }
+  mem_peak_total = 0;
+
   /* GPU device selection if they are accessible */
 
 #ifdef _OPENACC
@@ -84,6 +133,17 @@ micropp<tdim>::micropp(const micropp_params_t &params)
     calc_bmat(gp, bmat[gp]);
   }
 
+  if (spill_budget > 0 && access(params.spill_dir, W_OK)) {
+    cerr << "micropp : spill_dir " << params.spill_dir << " is not writable, no spilling" << endl;
+    spill_budget = 0;
+  }
+  struct statfs spill_fs;
+  if (spill_budget > 0 && !statfs(params.spill_dir, &spill_fs) && spill_fs.f_type == TMPFS_MAGIC) {
+    cerr << "micropp : spill_dir " << params.spill_dir << " is in memory (tmpfs), the spilled GPs do not free any"
+         << endl;
+  }
+  slab_init(&gp_slab, GP_SLAB_CHUNK, (spill_budget > 0) ? params.spill_dir : nullptr);
+
   gp_list = new gp_t<tdim>[ngp]();
   for (int gp = 0; gp < ngp; ++gp) {
     if (params.coupling != nullptr) {
@@ -95,13 +155,48 @@ micropp<tdim>::micropp(const micropp_params_t &params)
     }
 
     gp_list[gp].nndim = nndim;
-    gp_list[gp].nvars = nvars;
+    gp_list[gp].nelem = nelem;
+    gp_list[gp].slab = &gp_slab;
 
-    if (params.coupling == nullptr || (params.coupling[gp] == FE_ONE_WAY || params.coupling[gp] == FE_FULL)) {
+    if (u_storage == U_PLAIN &&
+        (params.coupling == nullptr || (params.coupling[gp] == FE_ONE_WAY || params.coupling[gp] == FE_FULL))) {
       gp_list[gp].allocate_u();
     }
   }
 
+  numa_init();
+
+  /*
+   * First touch of the displacements. With <numa> it is done by the node
+   * that takes the GP first in homogenize. Otherwise the placement is only
+   * best-effort: homogenize schedules the GPs dynamically (their costs
+   * differ), so a GP may run on a thread of another node than this one.
+   */
+  if (numa) {
+#pragma omp parallel
+    {
+      const int node = get_thread_node();
+      for (int k = 0; k < numa_nodes; ++k) {
+        int gp;
+        while ((gp = numa_take_gp((node + k) % numa_nodes)) >= 0) {
+          if (gp_list[gp].u_n != nullptr) {
+            memset(gp_list[gp].u_n, 0, nndim * sizeof(double));
+            memset(gp_list[gp].u_k, 0, nndim * sizeof(double));
+          }
+        }
+      }
+    }
+    memset(numa_next, 0, numa_nodes * sizeof(int));
+  } else {
+#pragma omp parallel for schedule(static)
+    for (int gp = 0; gp < ngp; ++gp) {
+      if (gp_list[gp].u_n != nullptr) {
+        memset(gp_list[gp].u_n, 0, nndim * sizeof(double));
+        memset(gp_list[gp].u_k, 0, nndim * sizeof(double));
+      }
+    }
+  }
+
   elem_type = (int *)calloc(nelem, sizeof(int));
   elem_stress = (double *)calloc(nelem * nvoi, sizeof(double));
   elem_strain = (double *)calloc(nelem * nvoi, sizeof(double));
@@ -125,32 +220,99 @@ micropp<tdim>::micropp(const micropp_params_t &params)
 
   calc_volume_fractions();
 
-  if (params.use_A0) {
 #ifdef _OPENMP
-    int num_of_A0s = omp_get_max_threads();
+  num_solvers = omp_get_max_threads();
 #else
-    int num_of_A0s = 1;
+  num_solvers = 1;
 #endif
-    A0 = (ell_matrix *)malloc(num_of_A0s * sizeof(ell_matrix));
+  solvers = (ell_solver *)malloc(num_solvers * sizeof(ell_solver));
 
-#pragma omp parallel for schedule(dynamic, 1)
-    for (int i = 0; i < num_of_A0s; ++i) {
-      ell_init(&A0[i], dim, dim, params.size, CG_ABS_TOL, CG_REL_TOL, CG_MAX_ITS);
-      double *u = (double *)calloc(nndim, sizeof(double));
-      assembly_mat(&A0[i], u, nullptr);
-      free(u);
+#pragma omp parallel for schedule(static, 1)
+  for (int i = 0; i < num_solvers; ++i) {
+    ell_solver_init(&solvers[i], nndim, params.cg_abs_tol, params.cg_rel_tol, params.cg_max_its);
+  }
+
+  if (params.use_A0) {
+    ell_init(&A0, dim, dim, params.size);
+    double *u = (double *)calloc(nndim, sizeof(double));
+    assembly_mat(&A0, u, nullptr);
+    free(u);
+
+    if (use_A0_chol) {
+      if (chol_init(&A0_chol, &A0)) {
+        chol_free(&A0_chol);
+        use_A0_chol = false;
+      }
     }
   }
 
+  numa_replicate();
+
+  /* The Cholesky preconditioner already removes the coarse error modes */
+  use_defl = use_defl && !use_A0_chol;
+  defl_blocks = params.cg_defl_blocks;
+  if (use_defl) {
+    defls = (defl_space *)malloc(num_solvers * sizeof(defl_space));
+    for (int i = 0; i < num_solvers; ++i) {
+      defls[i] = defl_space();
+      use_defl = use_defl && !defl_init(&defls[i], dim, dim, params.size, params.cg_defl_blocks);
+    }
+
+    if (use_defl && use_A0) {
+      defl_init(&A0_defl, dim, dim, params.size, params.cg_defl_blocks);
+      use_defl = !defl_update(&A0_defl, &A0);
+    }
+
+    if (!use_defl) {
+      for (int i = 0; i < num_solvers; ++i) defl_free(&defls[i]);
+      free(defls);
+      defl_free(&A0_defl);
+    }
+  }
+
+  if (nr_modified) {
+    const size_t jac_size = (size_t)nndim * mypow(3, dim) * dim * sizeof(double);
+    jac_keep_max = (int)((size_t)params.nr_jac_mem * 1024 * 1024 / jac_size);
+  }
+
   /* Average tangent constitutive tensor initialization */
 
   memset(ctan_lin_fe, 0.0, nvoi * nvoi * sizeof(double));
 
+  if (use_predictor) {
+    u_lin = (double *)calloc(nvoi * nndim, sizeof(double));
+  }
+
+  /* Memory kept until the destruction */
+  if (use_A0) {
+    mem_add(MEM_MATRICES, ell_get_bytes(&A0) * (numa ? 1 + numa_nodes : 1));
+  }
+  if (use_A0_chol) {
+    mem_add(MEM_MATRICES, chol_get_bytes(&A0_chol));
+  }
+  if (use_defl) {
+    if (use_A0) {
+      mem_add(MEM_MATRICES, defl_get_bytes(&A0_defl));
+    }
+    mem_add(MEM_WORKSPACES, num_solvers * defl_get_bytes(&defls[0]));
+  }
+  mem_add(MEM_WORKSPACES, num_solvers * ell_solver_get_bytes(&solvers[0]));
+  mem_add(MEM_WORKSPACES, nelem * (sizeof(int) * (numa ? 1 + numa_nodes : 1) + 2 * nvoi * sizeof(double)));
+  if (u_lin != nullptr) {
+    mem_add(MEM_WORKSPACES, nvoi * nndim * sizeof(double));
+  }
+  mem_update_gp_state();
+
   if (calc_ctan_lin_flag) {
     int num_fe_points = gp_counter[FE_LINEAR] + gp_counter[FE_ONE_WAY] + gp_counter[FE_FULL];
     if (num_fe_points > 0) {
       calc_ctan_lin_fe_models();
+    } else {
+      use_predictor = false;
     }
+  } else {
+    /* The unit-strain fields are a by-product of ctan_lin_fe */
+    use_predictor = false;
   }
 
   for (int gp = 0; gp < ngp; ++gp) {
@@ -164,6 +326,12 @@ micropp<tdim>::micropp(const micropp_params_t &params)
     }
   }
 
+  /* Scratch of the FE GPs, after the tangents so their matrices do not add up */
+  works = nullptr;
+  if (gp_counter[FE_ONE_WAY] + gp_counter[FE_FULL] > 0) {
+    works_init(0);
+  }
+
 #ifdef _CUDA
   cuda_init(params);
 #endif
@@ -178,7 +346,21 @@ micropp<tdim>::micropp(const micropp_params_t &params)
     strcpy(filename, file_name_string.c_str());
 
     ofstream_log.open(filename, ios::out);
-    ofstream_log << "#<gp_id>  <non-linear>  <cost>  <converged>" << endl;
+    ofstream_log << "#<gp_id>  <non-linear>  <cost>  <converged>  <substeps>  <substep_cuts>" << endl;
+  }
+
+  if (telemetry_log != TELEM_LOG_NONE) {
+    std::stringstream filename_stream;
+    filename_stream << "micropp-telemetry-" << mpi_rank << ((telemetry_log == TELEM_LOG_CSV) ? ".csv" : ".bin");
+    ofstream_telem.open(filename_stream.str(), ios::out | ios::binary);
+    if (telemetry_log == TELEM_LOG_CSV) {
+      ofstream_telem << "id,gp,newton_its,solver_its,nsolves,max_solve_its,substeps,substep_cuts,converged,bytes,"
+                     << "t_total,t_assembly,t_solve,t_material,residual_first,residual_last" << endl;
+    }
+  }
+
+  for (int i = 0; i < params.output_threads; ++i) {
+    output_workers.push_back(std::thread(&micropp<tdim>::output_worker, this));
   }
 }
 
@@ -188,29 +370,76 @@ micropp<tdim>::~micropp() {
 
   cout << "Calling micropp<" << dim << "> destructor" << endl;
 
+  restart_wait();
+
+  output_flush();
+  {
+    std::lock_guard<std::mutex> lock(output_mutex);
+    output_stop = true;
+  }
+  output_cv.notify_all();
+  for (std::thread &worker : output_workers) worker.join();
+
   free(elem_stress);
   free(elem_strain);
   free(elem_type);
 
   if (use_A0) {
-#ifdef _OPENMP
-    int num_of_A0s = omp_get_max_threads();
-#else
-    int num_of_A0s = 1;
-#endif
+    ell_free(&A0);
+  }
 
-#pragma omp parallel for schedule(dynamic, 1)
-    for (int i = 0; i < num_of_A0s; ++i) {
-      ell_free(&A0[i]);
+  for (int i = 0; i < num_solvers; ++i) {
+    ell_solver_free(&solvers[i]);
+  }
+  free(solvers);
+
+  if (works != nullptr) {
+    for (int i = 0; i < num_solvers; ++i) {
+      ell_free(&works[i].A);
+      free(works[i].b);
+      free(works[i].du);
+      free(works[i].u);
+      free(works[i].u_conv);
+      free(works[i].bfgs_s);
+      free(works[i].bfgs_y);
+      vars_free(&works[i].vars_aux);
     }
-    free(A0);
+    free(works);
+  }
+
+  if (use_A0_chol) {
+    chol_free(&A0_chol);
   }
 
+  if (use_defl) {
+    for (int i = 0; i < num_solvers; ++i) defl_free(&defls[i]);
+    free(defls);
+    defl_free(&A0_defl);
+  }
+
+  free(u_lin);
+
   for (int i = 0; i < MAX_MATERIALS; ++i) {
     delete material_list[i];
   }
 
   delete[] gp_list;
+  slab_free(&gp_slab);
+
+  if (numa) {
+    for (int i = 0; i < numa_nodes; ++i) {
+      if (use_A0) {
+        ell_free(&A0_node[i]);
+      }
+      free(elem_type_node[i]);
+    }
+    free(A0_node);
+    free(elem_type_node);
+    topo_free(&topo);
+  }
+  free(thread_node);
+  free(numa_first);
+  free(numa_next);
 }
 
 template <int tdim>
@@ -241,6 +470,283 @@ bool micropp<tdim>::has_subiterated(int gp_id) const {
   return gp_list[gp_id].subiterated;
 }
 
+template <int tdim>
+const gp_telemetry *micropp<tdim>::get_telemetry(int gp_id) const {
+  assert(gp_id < ngp);
+  assert(gp_id >= 0);
+  return &gp_list[gp_id].telem;
+}
+
+template <int tdim>
+int micropp<tdim>::get_substeps(int gp_id) const {
+  assert(gp_id < ngp);
+  assert(gp_id >= 0);
+  return gp_list[gp_id].substeps;
+}
+
+template <int tdim>
+int micropp<tdim>::get_substep_cuts(int gp_id) const {
+  assert(gp_id < ngp);
+  assert(gp_id >= 0);
+  return gp_list[gp_id].substep_cuts;
+}
+
+template <int tdim>
+void micropp<tdim>::grow_solvers() {
+  /* One solver (and deflation space) and node for each thread that can run newton_raphson */
+#ifdef _OPENMP
+  const int nthreads = omp_get_max_threads();
+#else
+  const int nthreads = 1;
+#endif
+  if (nthreads <= num_solvers) {
+    return;
+  }
+
+  numa_threads(nthreads);
+
+  const int ns[3] = {nx, ny, nz};
+  const int nnew = nthreads - num_solvers;
+
+  /* The settings of solvers[0] are the ones of the params between the solves */
+  solvers = (ell_solver *)realloc(solvers, nthreads * sizeof(ell_solver));
+  for (int i = num_solvers; i < nthreads; ++i) {
+    solvers[i] = ell_solver();
+    ell_solver_init(&solvers[i], nndim, solvers[0].min_err, solvers[0].rel_err, solvers[0].max_its);
+  }
+  mem_add(MEM_WORKSPACES, nnew * ell_solver_get_bytes(&solvers[0]));
+
+  if (use_defl) {
+    defls = (defl_space *)realloc(defls, nthreads * sizeof(defl_space));
+    bool defl_ok = true;
+    for (int i = num_solvers; i < nthreads; ++i) {
+      defls[i] = defl_space();
+      defl_ok = defl_ok && !defl_init(&defls[i], dim, dim, ns, defl_blocks);
+    }
+    mem_add(MEM_WORKSPACES, nnew * defl_get_bytes(&defls[0]));
+
+    /* As in the constructor, plain CG if a space can not be built */
+    if (!defl_ok) {
+      mem_add(MEM_WORKSPACES, -nthreads * defl_get_bytes(&defls[0]));
+      for (int i = 0; i < nthreads; ++i) defl_free(&defls[i]);
+      free(defls);
+      if (use_A0) {
+        mem_add(MEM_MATRICES, -defl_get_bytes(&A0_defl));
+      }
+      defl_free(&A0_defl);
+      use_defl = false;
+    }
+  }
+
+  const int first = num_solvers;
+  num_solvers = nthreads;
+  if (works != nullptr) {
+    works_init(first);
+  }
+}
+
+template <int tdim>
+gp_work *micropp<tdim>::get_work() {
+#ifdef _OPENMP
+  const int tid = omp_get_thread_num();
+#else
+  const int tid = 0;
+#endif
+  assert(works != nullptr && tid < num_solvers);  // see grow_solvers
+  return &works[tid];
+}
+
+template <int tdim>
+void micropp<tdim>::works_init(const int first) {
+  /* Scratch of the threads [first, num_solvers), allocated and first touched by each of them */
+  const int ns[3] = {nx, ny, nz};
+  const int max_pairs = min(nr_max_its, NR_MAX_BFGS_PAIRS);
+  works = (gp_work *)realloc(works, num_solvers * sizeof(gp_work));
+
+#pragma omp parallel for schedule(static, 1)
+  for (int i = 0; i < num_solvers; ++i) {
+    if (i < first) {
+      continue;
+    }
+    gp_work *work = &works[i];
+    work->A = ell_matrix();
+    ell_init(&work->A, dim, dim, ns);
+    work->b = (double *)calloc(nndim, sizeof(double));
+    work->du = (double *)calloc(nndim, sizeof(double));
+    work->u = (double *)calloc(nndim, sizeof(double));
+    work->u_conv = (subiterations) ? (double *)calloc(nndim, sizeof(double)) : nullptr;
+    work->bfgs_s = (nr_bfgs) ? (double *)calloc(max_pairs * nndim, sizeof(double)) : nullptr;
+    work->bfgs_y = (nr_bfgs) ? (double *)calloc(max_pairs * nndim, sizeof(double)) : nullptr;
+    work->vars_aux = vars_map();
+    vars_init(&work->vars_aux, nelem, npe);
+  }
+
+  const long work_bytes = (3L + (subiterations ? 1 : 0) + (nr_bfgs ? 2 * max_pairs : 0)) * nndim * sizeof(double);
+  for (int i = first; i < num_solvers; ++i) {
+    mem_add(MEM_MATRICES, ell_get_bytes(&works[i].A));
+    mem_add(MEM_WORKSPACES, work_bytes + vars_get_bytes(&works[i].vars_aux));
+  }
+}
+
+template <int tdim>
+void micropp<tdim>::get_numa_counts(long *local, long *remote) const {
+  *local = numa_local;
+  *remote = numa_remote;
+}
+
+template <int tdim>
+void micropp<tdim>::mem_add(const int cat, const long bytes) const {
+  /* <bytes> < 0 : released. Called from inside the parallel regions. */
+  const long current = (mem_current[cat] += bytes);
+  long peak = mem_peak[cat];
+  while (current > peak && !mem_peak[cat].compare_exchange_weak(peak, current)) {
+  }
+
+  long total = 0;
+  for (int c = 0; c < MEM_NCATS; ++c) total += mem_current[c];
+  peak = mem_peak_total;
+  while (total > peak && !mem_peak_total.compare_exchange_weak(peak, total)) {
+  }
+}
+
+template <int tdim>
+void micropp<tdim>::mem_update_gp_state() const {
+  /* The blocks handed out by the slab, with spill_mem part of them is in the spill files */
+  long bytes = ngp * sizeof(gp_t<tdim>) + slab_get_used(&gp_slab);
+  for (int gp = 0; gp < ngp; ++gp) {
+    bytes += cfield_get_bytes(&gp_list[gp].uc_n) + cfield_get_bytes(&gp_list[gp].uc_k);
+  }
+  mem_add(MEM_GP_STATE, bytes - mem_current[MEM_GP_STATE]);
+}
+
+template <int tdim>
+micropp_memory_t micropp<tdim>::get_memory_usage() const {
+  micropp_memory_t usage;
+  usage.current_total = 0;
+  for (int c = 0; c < MEM_NCATS; ++c) {
+    usage.current[c] = mem_current[c];
+    usage.peak[c] = mem_peak[c];
+    usage.current_total += usage.current[c];
+  }
+  usage.peak_total = mem_peak_total;
+  return usage;
+}
+
+template <int tdim>
+micropp_resources_t micropp<tdim>::estimate_resources(const micropp_params_t &params, const int nthreads) {
+  /*
+   * Same sizes as the constructor, the homogenizations and the output
+   * allocate. The NUMA replicas of A0 and elem_type are not included.
+   */
+  const int nx = params.size[0];
+  const int ny = params.size[1];
+  const int nz = (tdim == 3) ? params.size[2] : 1;
+  const long nn = (long)nx * ny * nz;
+  const long nndim = nn * dim;
+  const long nelem = (long)(nx - 1) * (ny - 1) * ((tdim == 3) ? nz - 1 : 1);
+  const int nnz = mypow(3, dim) * dim;
+  const long vec_bytes = nndim * sizeof(double);
+  const long ell_bytes = nndim * nnz * (sizeof(int) + sizeof(double));
+
+  int nfe = 0, nfull = 0;
+  for (int gp = 0; gp < params.ngp; ++gp) {
+    const int coupling = (params.coupling != nullptr) ? params.coupling[gp] : FE_ONE_WAY;
+    nfe += (coupling == FE_ONE_WAY || coupling == FE_FULL);
+    nfull += (coupling == FE_FULL);
+  }
+  const int nthreads_fe = (nfe > 0) ? nthreads : 0;  // the scratch of the GPs of each thread
+
+  /* Internal variables in all the elements, <vars_add> doubles the capacity on the slab (blocks of SLAB_ALIGN) */
+  int nvar = 0;
+  for (int i = 0; i < MAX_MATERIALS; ++i) {
+    material_t *material = material_t::make_material(params.materials[i]);
+    nvar = max(nvar, material->get_nvars());
+    delete material;
+  }
+  const long vars_size = nelem * npe * nvar;
+  long vars_capacity = 0, vars_slab = 0;
+  if (nvar > 0) {
+    for (vars_capacity = 64L * npe * nvar; vars_capacity < vars_size; vars_capacity *= 2) {
+      vars_slab += vars_capacity * sizeof(double) + SLAB_ALIGN;
+    }
+    vars_slab += vars_capacity * sizeof(double) + nelem * sizeof(long) + 2 * SLAB_ALIGN;
+  }
+
+  micropp_resources_t res;
+
+  /* GP state : u_n / u_k, vars_n / vars_k and the kept jacobians in the slab */
+  long slab = nfe * (2 * (vec_bytes + SLAB_ALIGN) + 2 * vars_slab);
+  if (params.nr_modified) {
+    const long jac_bytes = nndim * nnz * sizeof(double);
+    slab += min((long)(nfe - nfull), (long)params.nr_jac_mem * 1024 * 1024 / jac_bytes) * (jac_bytes + SLAB_ALIGN);
+  }
+  res.bytes[MEM_GP_STATE] = params.ngp * sizeof(gp_t<tdim>) + slab;
+
+  /* Matrices : A0, its Cholesky factor and deflation, one jacobian per thread */
+  const bool use_A0_chol = params.use_A0 && params.use_A0_chol;
+  const bool use_defl = params.cg_defl_blocks > 0 && !use_A0_chol;
+  long defl_bytes = 0;
+  if (use_defl) {
+    int ndef = dim;
+    for (int i = 0; i < dim; ++i) ndef *= max(1, min(params.cg_defl_blocks, params.size[i] - 2));
+    const int width = (dim == 3) ? 27 : 9;
+    defl_bytes = nn * (1 + width) * sizeof(int) + 2 * nndim * width * dim * sizeof(double) +
+                 (long)ndef * ndef * sizeof(double) + ndef * (sizeof(int) + sizeof(double));
+  }
+  const int nthreads_A = max(nthreads_fe, params.calc_ctan_lin ? min(nthreads, (int)nvoi) : 0);
+  res.bytes[MEM_MATRICES] = nthreads_A * ell_bytes;
+  if (params.use_A0) {
+    res.bytes[MEM_MATRICES] += ell_bytes + (use_defl ? defl_bytes : 0);
+  }
+  if (use_A0_chol) {
+    const long nfree = (long)(nx - 2) * (ny - 2) * ((tdim == 3) ? nz - 2 : 1) * dim;
+    const long nnz_L = (long)(EST_CHOL_FILL * pow((double)nfree, 1.5));
+    res.bytes[MEM_MATRICES] +=
+        nfree * sizeof(int) + (nfree + 1) * sizeof(long) + nnz_L * (sizeof(int) + sizeof(double));
+  }
+
+  /* Workspaces : CG solvers, element fields and the vectors of each homogenization */
+  long gp_work = 3 * vec_bytes + ((nvar > 0) ? nelem * sizeof(long) + vars_capacity * sizeof(double) : 0);
+  if (params.subiterations) {
+    gp_work += vec_bytes;
+  }
+  if (params.nr_modified && params.nr_bfgs) {
+    gp_work += 2 * min(params.nr_max_its, NR_MAX_BFGS_PAIRS) * vec_bytes;
+  }
+  res.bytes[MEM_WORKSPACES] = nthreads * (5 * vec_bytes + defl_bytes) + nthreads_fe * gp_work +
+                              nelem * (sizeof(int) + 2 * nvoi * sizeof(double));
+  if (params.use_predictor && params.calc_ctan_lin) {
+    res.bytes[MEM_WORKSPACES] += nvoi * vec_bytes;
+  }
+
+  /* Output : the files being written and queued, a full restart snapshot */
+  const long vtu_bytes =
+      2 * nn * 3 * sizeof(double) + nelem * ((npe + 3) * sizeof(int) + (2 * nvoi + 4) * sizeof(double));
+  const long job_bytes = vec_bytes + ((nvar > 0) ? nelem * sizeof(long) + vars_size * sizeof(double) : 0);
+  const int writers = max(1, params.output_threads);
+  res.bytes[MEM_OUTPUT] = writers * (2 * nelem * nvoi * sizeof(double) + vtu_bytes) +
+                          params.output_threads * (OUTPUT_QUEUE_JOBS + 1) * job_bytes;
+  res.bytes[MEM_OUTPUT] += params.ngp * (sizeof(restart_entry) + sizeof(char) + nvoi * sizeof(double)) +
+                           nfe * (job_bytes + sizeof(long));
+
+  res.bytes_total = 0;
+  for (int c = 0; c < MEM_NCATS; ++c) res.bytes_total += res.bytes[c];
+
+  /* Flops : B^T sigma and B^T C B over the Gauss points, nr_max_its iterations of each solve */
+  const double flops_rhs = npe * (4.0 * nvoi * npe * dim + 2.0 * nvoi * nvoi);
+  const double flops_mat = npe * (2.0 * nvoi * nvoi * npe * dim + 2.0 * nvoi * (npe * dim) * (npe * dim));
+  const int cg_its = min(params.cg_max_its, EST_CG_ITS * max(nx, max(ny, nz)));
+  const int its = params.nr_max_its;
+
+  res.flops_assembly = nelem * (flops_rhs + flops_mat);
+  res.flops_cg_it = 2.0 * nndim * nnz + 11.0 * nndim;
+  const double flops_solve = (its + 1) * nelem * flops_rhs + its * (nelem * flops_mat + cg_its * res.flops_cg_it);
+  res.flops_step = (nfe - nfull) * flops_solve + nfull * (1 + nvoi) * flops_solve +
+                   (params.ngp - nfe) * 2.0 * nvoi * nvoi;
+
+  return res;
+}
+
 template <int tdim>
 int micropp<tdim>::get_non_linear_gps(void) const {
   int count = 0;
@@ -259,10 +765,13 @@ void micropp<tdim>::calc_ctan_lin_fe_models() {
     const int ns[3] = {nx, ny, nz};
 
     ell_matrix A;  // Jacobian
-    ell_init(&A, dim, dim, ns, CG_ABS_TOL, CG_REL_TOL, CG_MAX_ITS);
+    ell_init(&A, dim, dim, ns);
     double *b = (double *)calloc(nndim, sizeof(double));
     double *du = (double *)calloc(nndim, sizeof(double));
     double *u = (double *)calloc(nndim, sizeof(double));
+    const long work_bytes = 3L * nndim * sizeof(double);
+    mem_add(MEM_MATRICES, ell_get_bytes(&A));
+    mem_add(MEM_WORKSPACES, work_bytes);
 
     double sig[6];
     double eps[nvoi] = {0.0};
@@ -276,6 +785,14 @@ void micropp<tdim>::calc_ctan_lin_fe_models() {
       ctan_lin_fe[v * nvoi + i] = sig[v] / D_EPS_CTAN_AVE;
     }
 
+    if (u_lin) {
+      for (int j = 0; j < nndim; ++j) {
+        u_lin[i * nndim + j] = u[j] / D_EPS_CTAN_AVE;
+      }
+    }
+
+    mem_add(MEM_MATRICES, -ell_get_bytes(&A));
+    mem_add(MEM_WORKSPACES, -work_bytes);
     ell_free(&A);
     free(b);
     free(u);
@@ -332,7 +849,119 @@ void micropp<tdim>::calc_ctan_lin_mix_rule_Chamis(double ctan[nvoi * nvoi]) {
 
 template <int tdim>
 material_t *micropp<tdim>::get_material(const int e) const {
-  return material_list[elem_type[e]];
+  return material_list[get_elem_type()[e]];
+}
+
+template <int tdim>
+int micropp<tdim>::get_thread_node() const {
+#ifdef _OPENMP
+  return thread_node[omp_get_thread_num()];
+#else
+  return thread_node[0];
+#endif
+}
+
+template <int tdim>
+const ell_matrix *micropp<tdim>::get_A0() const {
+  /* Replica of the node of the calling thread (once they are built) */
+  return (A0_node != nullptr) ? &A0_node[get_thread_node()] : &A0;
+}
+
+template <int tdim>
+const int *micropp<tdim>::get_elem_type() const {
+  return (elem_type_node != nullptr) ? elem_type_node[get_thread_node()] : elem_type;
+}
+
+template <int tdim>
+void micropp<tdim>::numa_init() {
+  if (numa) {
+    topo_init(&topo);
+    numa_nodes = topo.nnodes;
+  }
+
+#ifdef _OPENMP
+  const int nthreads = omp_get_max_threads();
+#else
+  const int nthreads = 1;
+#endif
+  numa_threads(nthreads);
+
+  numa_first = (int *)malloc((numa_nodes + 1) * sizeof(int));
+  numa_next = (int *)calloc(numa_nodes, sizeof(int));
+  for (int i = 0; i <= numa_nodes; ++i) {
+    numa_first[i] = (int)((long)i * ngp / numa_nodes);
+  }
+}
+
+template <int tdim>
+void micropp<tdim>::numa_threads(const int nthreads) {
+  /* Node of each of the <nthreads> OpenMP threads, all 0 without numa */
+  thread_node = (int *)realloc(thread_node, nthreads * sizeof(int));
+  memset(thread_node, 0, nthreads * sizeof(int));
+  if (numa) {
+#pragma omp parallel
+    {
+#ifdef _OPENMP
+      const int tid = omp_get_thread_num();
+#else
+      const int tid = 0;
+#endif
+      thread_node[tid] = min(topo_get_node(&topo), numa_nodes - 1);
+    }
+  }
+}
+
+template <int tdim>
+void micropp<tdim>::numa_replicate() {
+  /*
+   * The first thread of each node copies A0 and elem_type, so the copy is
+   * placed on it. The nodes with no threads get a copy from the master.
+   */
+  if (!numa) {
+    return;
+  }
+
+  A0_node = (use_A0) ? (ell_matrix *)malloc(numa_nodes * sizeof(ell_matrix)) : nullptr;
+  elem_type_node = (int **)calloc(numa_nodes, sizeof(int *));
+
+  auto replicate = [&](const int node) {
+    elem_type_node[node] = (int *)malloc(nelem * sizeof(int));
+    memcpy(elem_type_node[node], elem_type, nelem * sizeof(int));
+    if (use_A0) {
+      const int ns[3] = {nx, ny, nz};
+      A0_node[node] = ell_matrix();
+      ell_init(&A0_node[node], dim, dim, ns);
+      memcpy(A0_node[node].vals, A0.vals, A0.nrow * A0.nnz * sizeof(double));
+    }
+  };
+
+#pragma omp parallel
+  {
+    const int node = get_thread_node();
+    int first;
+#pragma omp atomic capture
+    first = numa_next[node]++;
+    if (first == 0) {
+      replicate(node);
+    }
+  }
+
+  for (int i = 0; i < numa_nodes; ++i) {
+    if (numa_next[i] == 0) {
+      replicate(i);
+    }
+    numa_next[i] = 0;
+  }
+}
+
+template <int tdim>
+int micropp<tdim>::numa_take_gp(const int node) {
+  /* Next GP of the block of <node>, -1 when all were taken */
+  int i;
+#pragma omp atomic capture
+  i = numa_next[node]++;
+  const int igp = numa_first[node] + i;
+  return (igp < numa_first[node + 1]) ? igp : -1;
 }
 
 template <int tdim>
@@ -557,6 +1186,30 @@ void micropp<tdim>::print_info() const {
   cout << "FE_FULL           : " << gp_counter[FE_FULL] << " GPs" << endl;
   cout << "MIX_RULE_CHAMIS   : " << gp_counter[MIX_RULE_CHAMIS] << " GPs" << endl;
   cout << "USE A0            : " << use_A0 << endl;
+  if (use_A0_chol) {
+    cout << "A0 CHOLESKY NNZ   : " << chol_get_nnz(&A0_chol) << endl;
+  }
+  if (use_defl) {
+    cout << "CG DEFLATION SIZE : " << defls[0].ndef << endl;
+  }
+  if (nr_modified) {
+    cout << "JACOBIANS KEPT    : " << jac_keep_max << endl;
+  }
+  cout << "NUMA NODES        : " << numa_nodes << endl;
+  long u_bytes = 0;
+  for (int gp = 0; gp < ngp; ++gp) {
+    if (gp_list[gp].u_n != nullptr) {
+      u_bytes += 2 * nndim * sizeof(double);
+    }
+    u_bytes += cfield_get_bytes(&gp_list[gp].uc_n) + cfield_get_bytes(&gp_list[gp].uc_k);
+  }
+  cout << "GP U [MB]         : " << u_bytes / (1024.0 * 1024.0) << endl;
+  cout << "GP SLAB [MB]      : " << slab_get_bytes(&gp_slab) / (1024.0 * 1024.0) << endl;
+  cout << "MEMORY PEAK [MB]  : " << mem_peak_total / (1024.0 * 1024.0) << endl;
+  if (spill_budget > 0) {
+    cout << "SPILL BUDGET [MB] : " << spill_budget / (1024.0 * 1024.0) << endl;
+    cout << "SPILLED GPs       : " << spill_outs << endl;
+  }
   cout << "NUM SUBITS        : " << nsubiterations << endl;
   cout << "MPI RANK          : " << mpi_rank << endl;
 
@@ -597,11 +1250,11 @@ void micropp<tdim>::print_info() const {
 }
 
 template <int tdim>
-void micropp<tdim>::get_stress(int gp, const double eps[nvoi], const double *vars_old, double stress_gp[nvoi], int ex,
+void micropp<tdim>::get_stress(int gp, const double eps[nvoi], const vars_map *vars_old, double stress_gp[nvoi], int ex,
                                int ey, int ez) const {
   const int e = glo_elem(ex, ey, ez);
   const material_t *material = get_material(e);
-  const double *vars = (vars_old) ? &vars_old[intvar_ix(e, gp, 0)] : nullptr;
+  const double *vars = vars_get(vars_old, e, gp, material->get_nvars());
 
   material->get_stress(eps, stress_gp, vars);
 }
@@ -100,6 +100,21 @@ bool micropp3_has_subiterated(const micropp3 *self, const int gp_id) {
   return ptr->has_subiterated(gp_id);
 }
 
+int micropp3_get_substeps(const micropp3 *self, const int gp_id) {
+  micropp<3> *ptr = (micropp<3> *)self->ptr;
+  return ptr->get_substeps(gp_id);
+}
+
+int micropp3_get_substep_cuts(const micropp3 *self, const int gp_id) {
+  micropp<3> *ptr = (micropp<3> *)self->ptr;
+  return ptr->get_substep_cuts(gp_id);
+}
+
+void micropp3_get_telemetry(const micropp3 *self, const int gp_id, gp_telemetry *telem) {
+  micropp<3> *ptr = (micropp<3> *)self->ptr;
+  memcpy(telem, ptr->get_telemetry(gp_id), sizeof(gp_telemetry));
+}
+
 void micropp3_update_vars(micropp3 *self) {
   micropp<3> *ptr = (micropp<3> *)self->ptr;
   ptr->update_vars();
@@ -115,6 +130,11 @@ void micropp3_output2(micropp3 *self, const int gp_id, const int elem_global, co
   ptr->output2(gp_id, elem_global, time_step);
 }
 
+void micropp3_output_flush(micropp3 *self) {
+  micropp<3> *ptr = (micropp<3> *)self->ptr;
+  ptr->output_flush();
+}
+
 void micropp3_print_info(micropp3 *self) {
   micropp<3> *ptr = (micropp<3> *)self->ptr;
   ptr->print_info();
@@ -135,8 +155,8 @@ void micropp3_write_restart(const micropp3 *self, const int restart_id) {
   ptr->write_restart(restart_id);
 }
 
-void micropp3_read_restart(const micropp3 *self, const int restart_id) {
+int micropp3_read_restart(const micropp3 *self, const int restart_id) {
   micropp<3> *ptr = (micropp<3> *)self->ptr;
-  ptr->read_restart(restart_id);
+  return ptr->read_restart(restart_id);
 }
 }
@@ -25,7 +25,7 @@
 #include "micropp.hpp"
 
 template <>
-double micropp<3>::assembly_rhs(const double *u, const double *vars_old, double *b) {
+double micropp<3>::assembly_rhs(const double *u, const vars_map *vars_old, double *b, double *stress_ave) {
   INST_START;
 
   memset(b, 0., nndim * sizeof(double));
@@ -125,11 +125,23 @@ double micropp<3>::assembly_rhs(const double *u, const double *vars_old, double
   for (int i = 0; i < nndim; ++i) norm += b[i] * b[i];
   norm = sqrt(norm);
 
+  if (stress_ave) {
+    calc_ave_stress(u, stress_ave, vars_old);
+  }
+
   return norm;
 }
 
 template <>
-void micropp<3>::assembly_mat(ell_matrix *A, const double *u, const double *vars_old) {
+double micropp<3>::assembly_rhs_mat(ell_matrix *A, const double *u, const vars_map *vars_old, double *b,
+                                     double *stress_ave) {
+  /* Not fused in this backend */
+  assembly_mat(A, u, vars_old);
+  return assembly_rhs(u, vars_old, b, stress_ave);
+}
+
+template <>
+void micropp<3>::assembly_mat(ell_matrix *A, const double *u, const vars_map *vars_old) {
   INST_START;
 
   ell_set_zero_mat(A);
@@ -181,7 +193,7 @@ void micropp<3>::assembly_mat(ell_matrix *A, const double *u, const double *vars
         const int e = glo_elem(ex, ey, ez);
         const material_t *material = get_material(e);
         for (int gp = 0; gp < npe; ++gp) {
-          const double *vars = (vars_old) ? &vars_old[intvar_ix(e, gp, 0)] : nullptr;
+          const double *vars = vars_get(vars_old, e, gp, material->get_nvars());
           material->get_ctan(&eps[ex * ney * nez * npe * 6 + ey * nez * npe * 6 + ez * npe * 6 + gp * 6],
                              &ctan[ex * ney * nez * npe * nvoi * nvoi + ey * nez * npe * nvoi * nvoi +
                                    ez * npe * nvoi * nvoi + gp * nvoi * nvoi],
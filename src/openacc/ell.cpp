@@ -58,77 +58,77 @@ double get_dot_acc(const double *v1, const double *v2, const int n) {
   return prod;
 }
 
-int ell_solve_cgpd(const ell_matrix *m, const double *b, double *x, double *err) {
+int ell_solve_cgpd(const ell_matrix *m, ell_solver *s, const double *b, double *x, double *err) {
   INST_START;
 
   /* Conjugate Gradient Algorithm (CG) with Jacobi Preconditioner */
 
-  if (!m || !b || !x) return 1;
+  if (!m || !s || !b || !x) return 1;
 
 #pragma acc enter data copyin(x[ : m->nrow], b[ : m->nrow])
 
-#pragma acc enter data copyin(m[0 : 1])
+#pragma acc enter data copyin(m[0 : 1], s[0 : 1])
 #pragma acc enter data copyin(m->cols[ : m->nrow * m->nnz], m->vals[ : m->nrow * m->nnz])
-#pragma acc enter data copyin(m->r[ : m->nrow], m->z[ : m->nrow], m->k[ : m->nrow], m->p[ : m->nrow], m->Ap[ : m->nrow])
+#pragma acc enter data copyin(s->r[ : m->nrow], s->z[ : m->nrow], s->k[ : m->nrow], s->p[ : m->nrow], s->Ap[ : m->nrow])
 
-#pragma acc parallel loop present(m[0 : 1], m->k[ : m->nrow], m->vals[ : m->nrow * m->nnz])
+#pragma acc parallel loop present(m[0 : 1], s->k[ : m->nrow], m->vals[ : m->nrow * m->nnz])
   for (int i = 0; i < m->nn; i++) {
     for (int d = 0; d < m->nfield; d++)
-      m->k[i * m->nfield + d] = 1 / m->vals[i * m->nfield * m->nnz + m->shift * m->nfield + d * m->nnz + d];
+      s->k[i * m->nfield + d] = 1 / m->vals[i * m->nfield * m->nnz + m->shift * m->nfield + d * m->nnz + d];
   }
 
 #pragma acc parallel loop present(m[0 : 1], m->nrow, x[ : m->nrow])
   for (int i = 0; i < m->nrow; ++i) x[i] = 0.0;
 
-  ell_mvp_acc(m, x, m->r);
+  ell_mvp_acc(m, x, s->r);
 
-#pragma acc parallel loop present(m[0 : 1], b[ : m->nrow], m->r[m->nrow])
-  for (int i = 0; i < m->nrow; ++i) m->r[i] = b[i] - m->r[i];
+#pragma acc parallel loop present(m[0 : 1], b[ : m->nrow], s->r[m->nrow])
+  for (int i = 0; i < m->nrow; ++i) s->r[i] = b[i] - s->r[i];
 
-#pragma acc parallel loop present(m[0 : 1], m->z[ : m->nrow], m->k[ : m->nrow], m->r[m->nrow])
-  for (int i = 0; i < m->nrow; ++i) m->z[i] = m->k[i] * m->r[i];
+#pragma acc parallel loop present(m[0 : 1], s->z[ : m->nrow], s->k[ : m->nrow], s->r[m->nrow])
+  for (int i = 0; i < m->nrow; ++i) s->z[i] = s->k[i] * s->r[i];
 
-#pragma acc parallel loop present(m[0 : 1], m->p[ : m->nrow], m->z[m->nrow])
-  for (int i = 0; i < m->nrow; ++i) m->p[i] = m->z[i];
+#pragma acc parallel loop present(m[0 : 1], s->p[ : m->nrow], s->z[m->nrow])
+  for (int i = 0; i < m->nrow; ++i) s->p[i] = s->z[i];
 
-  double rz = get_dot_acc(m->r, m->z, m->nrow);
+  double rz = get_dot_acc(s->r, s->z, m->nrow);
 
-  double pnorm_0 = sqrt(get_dot_acc(m->z, m->z, m->nrow));
+  double pnorm_0 = sqrt(get_dot_acc(s->z, s->z, m->nrow));
   double pnorm = pnorm_0;
 
   int its = 0;
-  while (its < m->max_its) {
-    if (pnorm < m->min_err || pnorm < pnorm_0 * m->rel_err) break;
+  while (its < s->max_its) {
+    if (pnorm < s->min_err || pnorm < pnorm_0 * s->rel_err) break;
 
-    ell_mvp_acc(m, m->p, m->Ap);
-    double pAp = get_dot_acc(m->p, m->Ap, m->nrow);
+    ell_mvp_acc(m, s->p, s->Ap);
+    double pAp = get_dot_acc(s->p, s->Ap, m->nrow);
 
     const double alpha = rz / pAp;
 
-#pragma acc parallel loop present(m[0 : 1], x[ : m->nrow], m->p[m->nrow]) copyin(alpha)
-    for (int i = 0; i < m->nrow; ++i) x[i] += alpha * m->p[i];
+#pragma acc parallel loop present(m[0 : 1], x[ : m->nrow], s->p[m->nrow]) copyin(alpha)
+    for (int i = 0; i < m->nrow; ++i) x[i] += alpha * s->p[i];
 
-#pragma acc parallel loop present(m[0 : 1], m->r[ : m->nrow], m->Ap[m->nrow]) copyin(alpha)
-    for (int i = 0; i < m->nrow; ++i) m->r[i] -= alpha * m->Ap[i];
+#pragma acc parallel loop present(m[0 : 1], s->r[ : m->nrow], s->Ap[m->nrow]) copyin(alpha)
+    for (int i = 0; i < m->nrow; ++i) s->r[i] -= alpha * s->Ap[i];
 
-#pragma acc parallel loop present(m[0 : 1], m->z[ : m->nrow], m->k[m->nrow], m->r[m->nrow])
-    for (int i = 0; i < m->nrow; ++i) m->z[i] = m->k[i] * m->r[i];
+#pragma acc parallel loop present(m[0 : 1], s->z[ : m->nrow], s->k[m->nrow], s->r[m->nrow])
+    for (int i = 0; i < m->nrow; ++i) s->z[i] = s->k[i] * s->r[i];
 
-    pnorm = sqrt(get_dot_acc(m->z, m->z, m->nrow));
+    pnorm = sqrt(get_dot_acc(s->z, s->z, m->nrow));
     double rz_n = 0;
-    rz_n = get_dot_acc(m->r, m->z, m->nrow);
+    rz_n = get_dot_acc(s->r, s->z, m->nrow);
 
     const double beta = rz_n / rz;
-#pragma acc parallel loop present(m[0 : 1], m->z[ : m->nrow], m->p[m->nrow]) copyin(beta)
-    for (int i = 0; i < m->nrow; ++i) m->p[i] = m->z[i] + beta * m->p[i];
+#pragma acc parallel loop present(m[0 : 1], s->z[ : m->nrow], s->p[m->nrow]) copyin(beta)
+    for (int i = 0; i < m->nrow; ++i) s->p[i] = s->z[i] + beta * s->p[i];
 
     rz = rz_n;
     its++;
   }
 
 #pragma acc exit data copyout(m->cols[ : m->nrow * m->nnz], m->vals[ : m->nrow * m->nnz])
-#pragma acc exit data copyout(m->r[ : m->nrow], m->z[ : m->nrow], m->k[ : m->nrow], m->p[ : m->nrow], m->Ap[ : m->nrow])
-#pragma acc exit data delete (m[0 : 1])
+#pragma acc exit data copyout(s->r[ : m->nrow], s->z[ : m->nrow], s->k[ : m->nrow], s->p[ : m->nrow], s->Ap[ : m->nrow])
+#pragma acc exit data delete (m[0 : 1], s[0 : 1])
 
 #pragma acc exit data copyout(x[ : m->nrow], b[ : m->nrow])
 
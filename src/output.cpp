@@ -24,6 +24,19 @@
 #include "common.hpp"
 #include "micropp.hpp"
 
+#include <algorithm>
+#include <chrono>
+
+#include <fcntl.h>
+#include <stdint.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifdef _ZLIB
+#include <zlib.h>
+#endif
+
 using namespace std;
 
 template <int tdim>
@@ -33,8 +46,23 @@ void micropp<tdim>::output(int gp_id, const char *filename) {
   assert(gp_id < ngp);
   assert(gp_id >= 0);
 
-  calc_fields(gp_list[gp_id].u_k, gp_list[gp_id].vars_n);
-  write_vtu(gp_list[gp_id].u_k, gp_list[gp_id].vars_n, filename);
+  if (!output_workers.empty()) {
+    output_push(gp_id, filename);
+    return;
+  }
+
+  const long u_bytes = 2L * nndim * sizeof(double);
+  double *u = (double *)malloc(nndim * sizeof(double));
+  double *work = (double *)malloc(nndim * sizeof(double));
+  mem_add(MEM_OUTPUT, u_bytes);
+  load_u(&gp_list[gp_id], u, work, true);
+
+  calc_fields(u, gp_list[gp_id].vars_n, elem_strain, elem_stress);
+  write_vtu(u, gp_list[gp_id].vars_n, elem_strain, elem_stress, filename);
+
+  mem_add(MEM_OUTPUT, -u_bytes);
+  free(u);
+  free(work);
 }
 
 template <int tdim>
@@ -60,164 +88,382 @@ void micropp<tdim>::output2(const int gp_id, const int elem_global, const int ti
   std::string file_name_string = filename_stream.str();
   strcpy(filename, file_name_string.c_str());
 
-  calc_fields(gp_list[gp_id].u_k, gp_list[gp_id].vars_n);
-  write_vtu(gp_list[gp_id].u_k, gp_list[gp_id].vars_n, filename);
+  if (output_vtm) {
+    output_steps[time_step].push_back(elem_global);
+  }
+
+  output(gp_id, filename);
 }
 
 template <int tdim>
-void micropp<tdim>::write_vtu(double *u, double *vars_old, const char *filename) {
-  std::stringstream fname_vtu_s;
-  fname_vtu_s << filename << ".vtu";
-  std::string fname_vtu = fname_vtu_s.str();
+void micropp<tdim>::output_push(const int gp_id, const char *filename) {
+  /* The GP can change as soon as this function returns */
+  const gp_t<tdim> *gp_ptr = &gp_list[gp_id];
+  output_job job;
+  job.filename = filename;
+  job.u = (double *)malloc(nndim * sizeof(double));
+  double *work = (double *)malloc(nndim * sizeof(double));
+  load_u(&gp_list[gp_id], job.u, work, true);
+  free(work);
+
+  job.linear = (gp_ptr->vars_n == nullptr);
+  if (!job.linear) {
+    vars_init(&job.vars, nelem, npe);
+    vars_copy(&job.vars, gp_ptr->vars_n);
+  }
+  mem_add(MEM_OUTPUT, nndim * sizeof(double) + (job.linear ? 0 : vars_get_bytes(&job.vars)));
+
+  /* Bounded queue : waits if the workers are behind */
+  std::unique_lock<std::mutex> lock(output_mutex);
+  output_done_cv.wait(lock, [this]() { return output_queue.size() < OUTPUT_QUEUE_JOBS * output_workers.size(); });
+  output_queue.push_back(job);
+  lock.unlock();
+  output_cv.notify_one();
+}
 
-  ofstream file;
-  file.open(fname_vtu);
+template <int tdim>
+void micropp<tdim>::output_worker() {
+  /* The fields are allocated at the first job, the output memory is 0 until something is written */
+  const long fields_bytes = 2L * nelem * nvoi * sizeof(double);
+  double *strain_e = nullptr;
+  double *stress_e = nullptr;
+
+  while (true) {
+    std::unique_lock<std::mutex> lock(output_mutex);
+    output_cv.wait(lock, [this]() { return output_stop || !output_queue.empty(); });
+    if (output_queue.empty()) {
+      break;
+    }
+    output_job job = output_queue.front();
+    output_queue.pop_front();
+    output_busy++;
+    lock.unlock();
+    output_done_cv.notify_all();
+
+    if (strain_e == nullptr) {
+      strain_e = (double *)malloc(nelem * nvoi * sizeof(double));
+      stress_e = (double *)malloc(nelem * nvoi * sizeof(double));
+      mem_add(MEM_OUTPUT, fields_bytes);
+    }
 
-  file << "<?xml version=\"1.0\"?>\n"
-       << "<VTKFile type=\"UnstructuredGrid\" version=\"0.1\" " << "byte_order=\"LittleEndian\">\n"
-       << "<UnstructuredGrid>\n"
-       << "<Piece NumberOfPoints=\"" << nn << "\" NumberOfCells=\"" << nelem << "\">\n"
-       << "<Points>\n"
-       << "<DataArray type=\"Float64\" Name=\"Position\" " << "NumberOfComponents=\"3\" format=\"ascii\">" << endl;
-
-  file << scientific;
-
-  for (int k = 0; k < nz; ++k) {
-    for (int j = 0; j < ny; ++j) {
-      for (int i = 0; i < nx; ++i) {
-        const double coor[3] = {i * dx, j * dy, k * dz};
-        for (int d = 0; d < 3; d++) file << coor[d] << " ";
-        file << "\n";
-      }
+    const vars_map *vars = job.linear ? nullptr : &job.vars;
+    calc_fields(job.u, vars, strain_e, stress_e);
+    write_vtu(job.u, vars, strain_e, stress_e, job.filename.c_str());
+
+    mem_add(MEM_OUTPUT, -(long)(nndim * sizeof(double)) - (job.linear ? 0 : vars_get_bytes(&job.vars)));
+    free(job.u);
+    if (!job.linear) {
+      vars_free(&job.vars);
     }
+
+    lock.lock();
+    output_busy--;
+    lock.unlock();
+    output_done_cv.notify_all();
   }
-  file << "</DataArray>\n</Points>\n<Cells>\n" << endl;
-
-  file << "<DataArray type=\"Int32\" Name=\"connectivity\" " << "NumberOfComponents=\"1\" format=\"ascii\">" << endl;
-  for (int ez = 0; ez < nez; ++ez) {
-    for (int ey = 0; ey < ney; ++ey) {
-      for (int ex = 0; ex < nex; ++ex) {
-        int n[8];
-        get_elem_nodes(n, nx, ny, ex, ey, ez);
-        for (int i = 0; i < npe; ++i) file << n[i] << ' ';
-        file << "\n";
-      }
-    }
+
+  if (strain_e != nullptr) {
+    mem_add(MEM_OUTPUT, -fields_bytes);
+    free(strain_e);
+    free(stress_e);
   }
-  file << "</DataArray>" << endl;
+}
 
-  int ce = npe;
-  file << "<DataArray type=\"Int32\" Name=\"offsets\" " << "NumberOfComponents=\"1\" format=\"ascii\">" << endl;
-  for (int e = 0; e < nelem; ++e) {
-    file << ce << " ";
-    ce += npe;
+template <int tdim>
+void micropp<tdim>::output_flush() {
+  {
+    std::unique_lock<std::mutex> lock(output_mutex);
+    output_done_cv.wait(lock, [this]() { return output_queue.empty() && output_busy == 0; });
   }
-  file << "\n</DataArray>" << endl;
-
-  file << "<DataArray type=\"UInt8\"  Name=\"types\" NumberOfComponents=\"1\" " << "format=\"ascii\">" << endl;
-  const int vtk_code = (dim == 2) ? 9 : 12;
-  for (int e = 0; e < nelem; ++e) file << vtk_code << " ";
-  file << "\n</DataArray>" << endl;
-  file << "</Cells>" << endl;
-
-  file << "<PointData Vectors=\"displ\" >" << endl;
-  file << "<DataArray type=\"Float64\" Name=\"displ\" " << "NumberOfComponents=\"3\" format=\"ascii\" >" << endl;
-  for (int n = 0; n < nn; ++n) {
-    for (int d = 0; d < MAX_DIM; ++d) file << ((dim == 2 && d == 2) ? 0.0 : u[n * dim + d]) << " ";
-    file << "\n";
+
+  for (const auto &step : output_steps) write_vtm(step.first);
+  output_steps.clear();
+}
+
+template <int tdim>
+void micropp<tdim>::write_vtm(const int time_step) const {
+  /*
+   * micropp-step-<mpi_rank>-<time_step>.vtm : multiblock with the files
+   * of output2 of <time_step>, one block per elem_global
+   *
+   */
+  std::stringstream filename_stream;
+  filename_stream << "micropp-step-" << mpi_rank << "-" << time_step << ".vtm";
+
+  ofstream file(filename_stream.str());
+  file << "<?xml version=\"1.0\"?>\n"
+       << "<VTKFile type=\"vtkMultiBlockDataSet\" version=\"1.0\" byte_order=\"LittleEndian\">\n"
+       << "<vtkMultiBlockDataSet>\n";
+  const std::vector<int> &elems = output_steps.at(time_step);
+  for (int i = 0; i < (int)elems.size(); ++i) {
+    file << "<DataSet index=\"" << i << "\" name=\"micropp-" << elems[i] << "\" file=\"micropp-" << elems[i] << "-"
+         << time_step << (vti_output ? ".vti" : ".vtu") << "\"/>\n";
   }
-  file << "</DataArray>" << endl;
+  file << "</vtkMultiBlockDataSet>\n"
+       << "</VTKFile>\n";
+}
 
-  file << "</PointData>" << endl;
+/* Element type of the VTK DataArrays */
+static const char *vtu_type(const double *) { return "Float64"; }
+static const char *vtu_type(const int *) { return "Int32"; }
+static const char *vtu_type(const unsigned char *) { return "UInt8"; }
 
-  file << "<CellData>" << endl;
-  file << "<DataArray type=\"Float64\" Name=\"strain\" " << "NumberOfComponents=\"" << nvoi << "\" format=\"ascii\">"
-       << endl;
-  for (int e = 0; e < nelem; ++e) {
-    for (int v = 0; v < nvoi; ++v) file << elem_strain[e * nvoi + v] << " ";
-    file << "\n";
+#ifdef _ZLIB
+static long vtu_write_zlib(ofstream &file, const void *data, const long bytes, const bool parallel) {
+  /*
+   * Block of the appended data for VTU_ZLIB : the vtkZLibDataCompressor
+   * header
+   *
+   *   [#blocks, block size, last block size, compressed sizes...]
+   *
+   * and the blocks compressed one by one, in parallel unless it runs in
+   * an output worker (the workers already write files side by side).
+   * Returns its size.
+   */
+  const long nblocks = (bytes + VTU_BLOCK - 1) / VTU_BLOCK;
+  std::vector<std::string> blocks(nblocks);
+  std::vector<uint64_t> header(3 + nblocks);
+  header[0] = nblocks;
+  header[1] = VTU_BLOCK;
+  header[2] = (nblocks > 0) ? bytes - (nblocks - 1) * VTU_BLOCK : 0;
+
+#pragma omp parallel for schedule(dynamic, 1) if (parallel)
+  for (long b = 0; b < nblocks; ++b) {
+    const uLong src_bytes = (b < nblocks - 1) ? VTU_BLOCK : header[2];
+    uLongf dst_bytes = compressBound(src_bytes);
+    blocks[b].resize(dst_bytes);
+    compress2((Bytef *)&blocks[b][0], &dst_bytes, (const Bytef *)data + b * VTU_BLOCK, src_bytes, 1);
+    blocks[b].resize(dst_bytes);
+    header[3 + b] = dst_bytes;
   }
-  file << "</DataArray>\n";
 
-  file << "<DataArray type=\"Float64\" Name=\"stress\" " << "NumberOfComponents=\"" << nvoi << "\" format=\"ascii\">"
-       << endl;
-  for (int e = 0; e < nelem; ++e) {
-    for (int v = 0; v < nvoi; ++v) file << elem_stress[e * nvoi + v] << " ";
-    file << "\n";
+  long written = header.size() * sizeof(uint64_t);
+  file.write((const char *)header.data(), written);
+  for (long b = 0; b < nblocks; ++b) {
+    file.write(blocks[b].data(), blocks[b].size());
+    written += blocks[b].size();
   }
-  file << "</DataArray>\n";
+  return written;
+}
+#endif
 
-  file << "<DataArray type=\"Int32\" Name=\"elem_type\" " << "NumberOfComponents=\"1\" format=\"ascii\">" << endl;
-  for (int e = 0; e < nelem; ++e) {
-    file << elem_type[e] << " ";
+/* Array of the appended data, written after the XML from where it lives */
+typedef struct {
+  const void *data;
+  long bytes;
+  long pos;  // VTU_ZLIB : file position of the offset attribute, patched once the size is known
+} vtu_array;
+
+#define VTU_OFFSET_DIGITS 20  // width of the VTU_ZLIB offsets, zero padded
+
+template <typename T>
+static void vtu_data_array(ofstream &file, const char *name, const int ncomp, const T *data, const long ntuples,
+                           const int format, std::vector<vtu_array> &arrays, long &offset) {
+  /*
+   * ascii : one tuple per line, appended : only the offset of its block
+   * after <AppendedData>. The raw offsets follow from the sizes of the
+   * arrays, the compressed ones are written once each block is done.
+   */
+  file << "<DataArray type=\"" << vtu_type(data) << "\" Name=\"" << name << "\" NumberOfComponents=\"" << ncomp
+       << "\" format=\"";
+  if (format == VTU_ASCII) {
+    file << "ascii\">\n";
+    for (long t = 0; t < ntuples; ++t) {
+      for (int c = 0; c < ncomp; ++c) file << +data[t * ncomp + c] << " ";
+      file << "\n";
+    }
+    file << "</DataArray>\n";
+  } else {
+    const long bytes = ntuples * ncomp * sizeof(T);
+    file << "appended\" offset=\"";
+    long pos = -1;
+    if (format == VTU_RAW) {
+      file << offset;
+      offset += sizeof(uint64_t) + bytes;
+    } else {
+      pos = file.tellp();
+      file << std::string(VTU_OFFSET_DIGITS, '0');
+    }
+    file << "\"/>\n";
+    arrays.push_back({data, bytes, pos});
   }
-  file << "\n</DataArray>" << endl;
+}
 
-  file << "<DataArray type=\"Float64\" Name=\"plasticity\" " << "NumberOfComponents=\"1\" format=\"ascii\">" << endl;
-  for (int e = 0; e < nelem; ++e) {
-    double plasticity = 0.0;
-    if (vars_old != nullptr) {
-      for (int gp = 0; gp < npe; ++gp) {
-        for (int v = 0; v < nvoi; ++v) {
-          plasticity += vars_old[intvar_ix(e, gp, v)] * vars_old[intvar_ix(e, gp, v)];
+template <int tdim>
+void micropp<tdim>::write_vtu(const double *u, const vars_map *vars_old, const double *strain_e,
+                             const double *stress_e, const char *filename) const {
+  /* UnstructuredGrid (.vtu) or, with vti_output, ImageData (.vti) : the grid is only its extent and spacing */
+  std::stringstream fname_vtu_s;
+  fname_vtu_s << filename << (vti_output ? ".vti" : ".vtu");
+  std::string fname_vtu = fname_vtu_s.str();
+  const char *grid = vti_output ? "ImageData" : "UnstructuredGrid";
+
+#ifndef _ZLIB
+  const int format = (vtu_format == VTU_ZLIB) ? VTU_RAW : vtu_format;
+#else
+  const int format = vtu_format;
+#endif
+
+  std::vector<double> coor;
+  std::vector<int> conn, offsets;
+  std::vector<unsigned char> types;
+  if (!vti_output) {
+    coor.resize(nn * 3);
+    for (int k = 0; k < nz; ++k) {
+      for (int j = 0; j < ny; ++j) {
+        for (int i = 0; i < nx; ++i) {
+          const int n = (k * ny + j) * nx + i;
+          coor[n * 3 + 0] = i * dx;
+          coor[n * 3 + 1] = j * dy;
+          coor[n * 3 + 2] = k * dz;
         }
       }
     }
-    plasticity += sqrt(plasticity);
-    file << plasticity / npe << " ";
-  }
-  file << "\n</DataArray>" << endl;
 
-  file << "<DataArray type=\"Float64\" Name=\"damage_e\" " << "NumberOfComponents=\"1\" format=\"ascii\">" << endl;
-  for (int e = 0; e < nelem; ++e) {
-    double damage = 0.0;
-    if (vars_old != nullptr) {
-      for (int gp = 0; gp < npe; ++gp) {
-        damage += vars_old[intvar_ix(e, gp, 0)];
+    conn.resize(nelem * npe);
+    for (int ez = 0; ez < nez; ++ez) {
+      for (int ey = 0; ey < ney; ++ey) {
+        for (int ex = 0; ex < nex; ++ex) {
+          const int e = glo_elem(ex, ey, ez);
+          int n[8];
+          get_elem_nodes(n, nx, ny, ex, ey, ez);
+          for (int i = 0; i < npe; ++i) conn[e * npe + i] = n[i];
+        }
       }
     }
-    file << damage / npe << " ";
+
+    offsets.resize(nelem);
+    for (int e = 0; e < nelem; ++e) offsets[e] = (e + 1) * npe;
+    types.assign(nelem, (dim == 2) ? 9 : 12);
   }
-  file << "\n</DataArray>" << endl;
 
-  file << "<DataArray type=\"Float64\" Name=\"damage_D\" " << "NumberOfComponents=\"1\" format=\"ascii\">" << endl;
-  for (int e = 0; e < nelem; ++e) {
-    double damage = 0.0;
-    if (vars_old != nullptr) {
-      for (int gp = 0; gp < npe; ++gp) {
-        damage += vars_old[intvar_ix(e, gp, 1)];
+  /* The displacements have 3 components in VTK */
+  std::vector<double> displ;
+  const double *u_vtk = u;
+  if (dim == 2) {
+    displ.assign(nn * 3, 0.0);
+    for (int n = 0; n < nn; ++n)
+      for (int d = 0; d < dim; ++d) displ[n * 3 + d] = u[n * dim + d];
+    u_vtk = displ.data();
+  }
+
+  /* Internal variable <v> of the Gauss points of <e>, zero if the element has no history or no such variable */
+  auto var_sum = [&](const int e, const int v) {
+    double sum = 0.0;
+    const int nvar = get_material(e)->get_nvars();
+    for (int gp = 0; gp < npe; ++gp) {
+      const double *vars = vars_get(vars_old, e, gp, nvar);
+      if (vars != nullptr && v < nvar) {
+        sum += vars[v];
       }
     }
-    file << damage / npe << " ";
-  }
-  file << "\n</DataArray>" << endl;
+    return sum;
+  };
 
-  file << "<DataArray type=\"Float64\" Name=\"hardening\" " << "NumberOfComponents=\"1\" format=\"ascii\">" << endl;
+  std::vector<double> plasticity(nelem), damage_e(nelem), damage_D(nelem), hardening(nelem);
   for (int e = 0; e < nelem; ++e) {
-    double hardening = 0.;
+    double plast = 0.0;
+    const int nvar = get_material(e)->get_nvars();
     for (int gp = 0; gp < npe; ++gp) {
-      if (vars_old != nullptr) {
-        hardening += vars_old[intvar_ix(e, gp, 6)];
+      const double *vars = vars_get(vars_old, e, gp, nvar);
+      if (vars != nullptr && nvar >= nvoi) {
+        for (int v = 0; v < nvoi; ++v) plast += vars[v] * vars[v];
+      }
+    }
+    plast += sqrt(plast);
+    plasticity[e] = plast / npe;
+    damage_e[e] = var_sum(e, 0) / npe;
+    damage_D[e] = var_sum(e, 1) / npe;
+    hardening[e] = var_sum(e, 6) / npe;
+  }
+
+  std::vector<char> buffer(VTU_BLOCK);
+  ofstream file;
+  file.rdbuf()->pubsetbuf(buffer.data(), buffer.size());
+  file.open(fname_vtu, ios::out | ios::binary);
+
+  file << "<?xml version=\"1.0\"?>\n";
+  if (format == VTU_ASCII) {
+    file << "<VTKFile type=\"" << grid << "\" version=\"0.1\" byte_order=\"LittleEndian\">\n";
+  } else {
+    file << "<VTKFile type=\"" << grid << "\" version=\"1.0\" byte_order=\"LittleEndian\" header_type=\"UInt64\""
+         << ((format == VTU_ZLIB) ? " compressor=\"vtkZLibDataCompressor\"" : "") << ">\n";
+  }
+
+  std::vector<vtu_array> arrays;
+  long offset = 0;
+
+  if (vti_output) {
+    const int extent[6] = {0, nx - 1, 0, ny - 1, 0, (dim == 3) ? nz - 1 : 0};
+    std::stringstream extent_s, spacing_s;
+    for (int i = 0; i < 6; ++i) extent_s << (i ? " " : "") << extent[i];
+    spacing_s << setprecision(17) << dx << " " << dy << " " << ((dim == 3) ? dz : 1.0);
+    file << "<ImageData WholeExtent=\"" << extent_s.str() << "\" Origin=\"0 0 0\" Spacing=\"" << spacing_s.str()
+         << "\">\n"
+         << "<Piece Extent=\"" << extent_s.str() << "\">\n";
+    file << scientific;
+  } else {
+    file << "<UnstructuredGrid>\n"
+         << "<Piece NumberOfPoints=\"" << nn << "\" NumberOfCells=\"" << nelem << "\">\n";
+    file << scientific;
+
+    file << "<Points>\n";
+    vtu_data_array(file, "Position", 3, coor.data(), nn, format, arrays, offset);
+    file << "</Points>\n";
+
+    file << "<Cells>\n";
+    vtu_data_array(file, "connectivity", npe, conn.data(), nelem, format, arrays, offset);
+    vtu_data_array(file, "offsets", 1, offsets.data(), nelem, format, arrays, offset);
+    vtu_data_array(file, "types", 1, types.data(), nelem, format, arrays, offset);
+    file << "</Cells>\n";
+  }
+
+  file << "<PointData Vectors=\"displ\">\n";
+  vtu_data_array(file, "displ", 3, u_vtk, nn, format, arrays, offset);
+  file << "</PointData>\n";
+
+  file << "<CellData>\n";
+  vtu_data_array(file, "strain", nvoi, strain_e, nelem, format, arrays, offset);
+  vtu_data_array(file, "stress", nvoi, stress_e, nelem, format, arrays, offset);
+  vtu_data_array(file, "elem_type", 1, elem_type, nelem, format, arrays, offset);
+  vtu_data_array(file, "plasticity", 1, plasticity.data(), nelem, format, arrays, offset);
+  vtu_data_array(file, "damage_e", 1, damage_e.data(), nelem, format, arrays, offset);
+  vtu_data_array(file, "damage_D", 1, damage_D.data(), nelem, format, arrays, offset);
+  vtu_data_array(file, "hardening", 1, hardening.data(), nelem, format, arrays, offset);
+  file << "</CellData>\n";
+  file << "</Piece>\n";
+  file << "</" << grid << ">\n";
+
+  if (format != VTU_ASCII) {
+    file << "<AppendedData encoding=\"raw\">\n_";
+    offset = 0;
+    for (const vtu_array &array : arrays) {
+      if (format == VTU_RAW) {
+        const uint64_t size = array.bytes;
+        file.write((const char *)&size, sizeof(uint64_t));
+        file.write((const char *)array.data, array.bytes);
       } else {
-        hardening += 0.0;
+#ifdef _ZLIB
+        const long end = file.tellp();
+        file.seekp(array.pos);
+        file << setw(VTU_OFFSET_DIGITS) << setfill('0') << offset;
+        file.seekp(end);
+        offset += vtu_write_zlib(file, array.data, array.bytes, output_workers.empty());
+#endif
       }
     }
-    file << hardening / npe << " ";
+    file << "\n</AppendedData>\n";
   }
-  file << "\n</DataArray>" << endl;
-  file << "</CellData>" << endl;
-  file << "</Piece>" << endl;
-  file << "</UnstructuredGrid>" << endl;
-  file << "</VTKFile>" << endl;
+  file << "</VTKFile>\n";
 
   file.close();
 }
 
 template <int tdim>
-void micropp<tdim>::write_restart(const int restart_id) const {
+void micropp<tdim>::write_restart(const int restart_id) {
   /*
    *
-   * micropp-restart-<mpi_rank>-<#restart>.dat
+   * micropp-restart-<mpi_rank>-<#restart>.bin (see restart.hpp)
    *
    */
   INST_START;
@@ -228,37 +474,236 @@ void micropp<tdim>::write_restart(const int restart_id) const {
   std::string file_name_string = filename_stream.str();
   strcpy(filename, file_name_string.c_str());
 
-  ofstream file;
-  file.open(filename, ios::out | ios::binary);
-  // file.open (filename, ios::out);
-  for (int igp = 0; igp < ngp; ++igp) {
-    gp_list[igp].write_restart(file);
+  /* One restart on the way at a time */
+  restart_wait();
+
+  /*
+   * Full once the deltas would cost more to replay than a new full
+   * restart, or if <restart_id> is a file the chain still relies on
+   */
+  const int ndeltas = (int)restart_chain.size() - 1;
+  const bool in_chain = (std::find(restart_chain.begin(), restart_chain.end(), restart_id) != restart_chain.end());
+  const bool full = (restart_chain.empty() || in_chain || ndeltas + 1 >= restart_full_every ||
+                     restart_delta_bytes >= restart_full_bytes);
+
+  int nrec = 0;
+  for (int igp = 0; igp < ngp; ++igp) nrec += (full || gp_list[igp].restart_dirty);
+
+  const long data_start = sizeof(restart_header) + nrec * sizeof(restart_entry);
+  restart_entry *table = (restart_entry *)malloc(nrec * sizeof(restart_entry));
+  long offset = data_start;
+  for (int igp = 0, r = 0; igp < ngp; ++igp) {
+    if (full || gp_list[igp].restart_dirty) {
+      table[r].gp = igp;
+      table[r].offset = offset;
+      table[r].bytes = gp_list[igp].get_restart_bytes();
+      offset += table[r].bytes;
+      r++;
+    }
   }
-  file.close();
+
+  /* Snapshot : the GPs can change as soon as this function returns */
+  const long data_bytes = offset - data_start;
+  char *snapshot = (char *)malloc(data_bytes);
+  mem_add(MEM_OUTPUT, nrec * sizeof(restart_entry) + data_bytes);
+
+#pragma omp parallel for schedule(dynamic, 1)
+  for (int r = 0; r < nrec; ++r) {
+    char *rec = snapshot + (table[r].offset - data_start);
+    gp_list[table[r].gp].pack_restart(rec);
+    table[r].crc = restart_crc32(rec, table[r].bytes);
+  }
+
+  for (int igp = 0; igp < ngp; ++igp) gp_list[igp].restart_dirty = false;
+
+  restart_header header;
+  memset(&header, 0, sizeof(restart_header));
+  strcpy(header.magic, RESTART_MAGIC);
+  header.version = RESTART_VERSION;
+  header.dim = dim;
+  header.size[0] = nx;
+  header.size[1] = ny;
+  header.size[2] = nz;
+  header.ngp = ngp;
+  header.nrec = nrec;
+  header.u_storage = u_storage;
+  header.prev = full ? -1 : restart_chain.back();
+
+  /* Microseconds of the clock : also larger than the ones of the files of earlier runs */
+  const long now = std::chrono::duration_cast<std::chrono::microseconds>(
+                       std::chrono::system_clock::now().time_since_epoch())
+                       .count();
+  restart_seq = max(restart_seq + 1, now);
+  header.seq = restart_seq;
+
+  if (full) {
+    restart_chain.clear();
+    restart_full_bytes = offset;
+    restart_delta_bytes = 0;
+  } else {
+    restart_delta_bytes += offset;
+  }
+  restart_chain.push_back(restart_id);
+
+  /* Written under a temporary name, a crash never leaves half a restart */
+  const std::string name(filename);
+  restart_writer = std::thread([=]() {
+    const std::string name_tmp = name + ".tmp";
+    ofstream file(name_tmp, ios::out | ios::binary);
+    file.write((char *)&header, sizeof(restart_header));
+    file.write((char *)table, nrec * sizeof(restart_entry));
+    file.write(snapshot, data_bytes);
+    file.close();
+    if (file.good()) {
+      rename(name_tmp.c_str(), name.c_str());
+    } else {
+      cerr << "micropp : error writing " << name << endl;
+    }
+    mem_add(MEM_OUTPUT, -(long)(nrec * sizeof(restart_entry)) - data_bytes);
+    free(table);
+    free(snapshot);
+  });
 }
 
 template <int tdim>
-void micropp<tdim>::read_restart(const int restart_id) const {
-  /*
-   *
-   * micropp-restart-<mpi_rank>-<#restart>.dat
-   *
-   */
-  INST_START;
+void micropp<tdim>::restart_wait() {
+  if (restart_writer.joinable()) {
+    restart_writer.join();
+  }
+}
 
+template <int tdim>
+const char *micropp<tdim>::restart_map(const int restart_id, long *bytes) const {
+  /* Mapping of a restart with its header and all its records checked, nullptr if it is not usable */
   char filename[128];
   std::stringstream filename_stream;
   filename_stream << "micropp-restart-" << mpi_rank << "-" << restart_id << ".bin";
   std::string file_name_string = filename_stream.str();
   strcpy(filename, file_name_string.c_str());
 
-  ifstream file;
-  file.open(filename, ios::in | ios::binary);
-  // file.open (filename, ios::out);
-  for (int igp = 0; igp < ngp; ++igp) {
-    gp_list[igp].read_restart(file);
+  const int fd = open(filename, O_RDONLY);
+  struct stat st;
+  if (fd < 0 || fstat(fd, &st) || st.st_size < (long)sizeof(restart_header)) {
+    cerr << "micropp : cannot read " << filename << endl;
+    if (fd >= 0) {
+      close(fd);
+    }
+    return nullptr;
   }
-  file.close();
+  const long file_bytes = st.st_size;
+  void *map = mmap(NULL, file_bytes, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED) {
+    cerr << "micropp : cannot map " << filename << endl;
+    return nullptr;
+  }
+
+  const char *data = (const char *)map;
+  const restart_header *header = (const restart_header *)data;
+  const restart_entry *table = (const restart_entry *)(data + sizeof(restart_header));
+
+  const bool header_ok = (!strncmp(header->magic, RESTART_MAGIC, sizeof(header->magic)) &&
+                          header->version == RESTART_VERSION && header->dim == dim && header->size[0] == nx &&
+                          header->size[1] == ny && header->size[2] == nz && header->ngp == ngp &&
+                          header->nrec >= 0 && header->u_storage == u_storage && header->prev != restart_id &&
+                          (long)(sizeof(restart_header) + header->nrec * sizeof(restart_entry)) <= file_bytes);
+  if (!header_ok) {
+    cerr << "micropp : " << filename << " does not match this micropp" << endl;
+    munmap(map, file_bytes);
+    return nullptr;
+  }
+
+  int nbad = 0;
+#pragma omp parallel for schedule(dynamic, 1) reduction(+ : nbad)
+  for (int r = 0; r < header->nrec; ++r) {
+    const restart_entry *entry = &table[r];
+    if (entry->gp < 0 || entry->gp >= ngp || entry->offset < 0 || entry->bytes < 0 ||
+        entry->offset + entry->bytes > file_bytes) {
+      nbad++;
+    } else if (restart_crc32(data + entry->offset, entry->bytes) != entry->crc) {
+      nbad++;
+    }
+  }
+
+  if (nbad > 0) {
+    cerr << "micropp : " << nbad << " corrupted records in " << filename << endl;
+    munmap(map, file_bytes);
+    return nullptr;
+  }
+  *bytes = file_bytes;
+  return data;
+}
+
+template <int tdim>
+int micropp<tdim>::read_restart(const int restart_id) {
+  /*
+   *
+   * micropp-restart-<mpi_rank>-<#restart>.bin (see restart.hpp)
+   *
+   */
+  INST_START;
+
+  /* The file can be the one of the last write_restart */
+  restart_wait();
+
+  /* The whole chain is checked before any GP is touched */
+  std::vector<const char *> chain;
+  std::vector<long> chain_bytes;
+  int id = restart_id;
+  int ierr = 0;
+  while (true) {
+    long bytes;
+    const char *data = restart_map(id, &bytes);
+
+    /* A file of the chain newer than the delta that needs it was overwritten */
+    const bool seq_ok = (data == nullptr || chain.empty() ||
+                         ((const restart_header *)data)->seq < ((const restart_header *)chain.back())->seq);
+    if (!seq_ok) {
+      cerr << "micropp : restart " << id << " of the chain of restart " << restart_id << " was overwritten" << endl;
+    }
+    if (data == nullptr || !seq_ok || (int)chain.size() == RESTART_MAX_CHAIN) {
+      ierr = 1;
+      if (data != nullptr) {
+        munmap((void *)data, bytes);
+      }
+      break;
+    }
+    chain.push_back(data);
+    chain_bytes.push_back(bytes);
+    id = ((const restart_header *)data)->prev;
+    if (id < 0) {
+      break;
+    }
+  }
+
+  /* A block of the variables must fit in the record */
+  std::vector<int> block(nelem);
+  for (int e = 0; e < nelem; ++e) block[e] = npe * get_material(e)->get_nvars();
+
+  /* From the full restart to <restart_id> */
+  for (int c = (int)chain.size() - 1; c >= 0 && !ierr; --c) {
+    const restart_header *header = (const restart_header *)chain[c];
+    const restart_entry *table = (const restart_entry *)(chain[c] + sizeof(restart_header));
+    int nbad = 0;
+#pragma omp parallel for schedule(dynamic, 1) reduction(+ : nbad)
+    for (int r = 0; r < header->nrec; ++r) {
+      const restart_entry *entry = &table[r];
+      nbad += gp_list[entry->gp].unpack_restart(chain[c] + entry->offset, entry->bytes, block.data());
+    }
+    if (nbad > 0) {
+      cerr << "micropp : " << nbad << " records of restart " << restart_id << " do not match their size or the mesh" << endl;
+      ierr = 1;
+    }
+  }
+
+  for (int c = 0; c < (int)chain.size(); ++c) munmap((void *)chain[c], chain_bytes[c]);
+
+  /* The next delta written can not rely on the GPs as they were */
+  for (int igp = 0; igp < ngp; ++igp) gp_list[igp].restart_dirty = true;
+
+  mem_update_gp_state();
+
+  return ierr;
 }
 
 template <int tdim>
@@ -268,7 +713,7 @@ void micropp<tdim>::write_log() {
    *
    * log_id : <log_id>
    *
-   * <gp_id>  <non-linear>  <cost>   <converged>
+   * <gp_id>  <non-linear>  <cost>   <converged>  <substeps>  <substep_cuts>
    *
    */
 
@@ -276,9 +721,48 @@ void micropp<tdim>::write_log() {
 
   for (int gp_id = 0; gp_id < ngp; ++gp_id) {
     ofstream_log << "\t" << gp_id << "\t" << gp_list[gp_id].allocated << "\t" << gp_list[gp_id].cost << "\t"
-                 << gp_list[gp_id].converged << endl;
+                 << gp_list[gp_id].converged << "\t" << gp_list[gp_id].substeps << "\t"
+                 << gp_list[gp_id].substep_cuts << endl;
   }
   log_id++;
 }
 
+template <int tdim>
+void micropp<tdim>::write_telemetry() {
+  /*
+   * Writes the telemetry of every GP after a homogenization
+   *
+   * TELEM_LOG_CSV    : one row per GP, the columns are in the header line
+   * TELEM_LOG_BINARY : per GP <int telemetry_id> <int gp_id> <gp_telemetry>
+   *                    in the native byte order
+   *
+   */
+
+  for (int gp_id = 0; gp_id < ngp; ++gp_id) {
+    const gp_telemetry *telem = &gp_list[gp_id].telem;
+
+    if (telemetry_log == TELEM_LOG_BINARY) {
+      ofstream_telem.write((const char *)&telemetry_id, sizeof(int));
+      ofstream_telem.write((const char *)&gp_id, sizeof(int));
+      ofstream_telem.write((const char *)telem, sizeof(gp_telemetry));
+      continue;
+    }
+
+    int max_solve_its = 0;
+    for (int i = 0; i < min(telem->nsolves, TELEM_MAX_ITS); ++i) {
+      max_solve_its = max(max_solve_its, telem->solve_its[i]);
+    }
+    const double res_first = (telem->nresiduals > 0) ? telem->residuals[0] : 0.0;
+    const double res_last = (telem->nresiduals > 0) ? telem->residuals[telem->nresiduals - 1] : 0.0;
+
+    ofstream_telem << telemetry_id << "," << gp_id << "," << telem->newton_its << "," << telem->solver_its << ","
+                   << telem->nsolves << "," << max_solve_its << "," << telem->substeps << "," << telem->substep_cuts
+                   << "," << telem->converged << "," << telem->bytes << "," << telem->t_total << ","
+                   << telem->t_assembly << "," << telem->t_solve << "," << telem->t_material << "," << res_first << ","
+                   << res_last << "\n";
+  }
+  ofstream_telem.flush();
+  telemetry_id++;
+}
+
 template class micropp<3>;
@@ -0,0 +1,201 @@
+/*
+ *  This source code is part of MicroPP: a finite element library
+ *  to solve microstructural problems for composite materials.
+ *
+ *  Copyright (C) - 2018 - Guido Giuntoli <gagiuntoli@gmail.com>
+ *						   Jimmy Aguilar Mena <kratsbinovish@gmail.com>
+ *                         Judicaël Grasset <judicael.grasset@stfc.ac.uk>
+ *                         Alejandro Figueroa <afiguer7@maisonlive.gmu.edu>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published
+ *  by the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "slab.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+int slab_init(slab_t *s, const size_t chunk_size, const char *dir) {
+  s->chunk_size = (chunk_size + SLAB_ALIGN - 1) / SLAB_ALIGN * SLAB_ALIGN;
+  s->nchunks = 0;
+  s->max_chunks = 8;
+  s->used = 0;
+  s->bytes = 0;
+  s->bytes_used = 0;
+  s->dir = (dir != NULL) ? strdup(dir) : NULL;
+  s->chunks = (char **)malloc(s->max_chunks * sizeof(char *));
+  s->sizes = (size_t *)malloc(s->max_chunks * sizeof(size_t));
+  s->fds = (int *)malloc(s->max_chunks * sizeof(int));
+  return (s->chunks == NULL || s->sizes == NULL || s->fds == NULL);
+}
+
+static void *slab_map_file(slab_t *s, const size_t size, int *fd) {
+  /* The file is unlinked at once, it lives while it is mapped */
+  char path[512];
+  snprintf(path, sizeof(path), "%s/micropp-slab-XXXXXX", s->dir);
+  *fd = mkstemp(path);
+  if (*fd < 0) {
+    return NULL;
+  }
+  unlink(path);
+
+  void *mem = MAP_FAILED;
+  if (!ftruncate(*fd, size)) {
+    mem = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, *fd, 0);
+  }
+  if (mem == MAP_FAILED) {
+    close(*fd);
+    return NULL;
+  }
+  return mem;
+}
+
+static int slab_grow(slab_t *s, const size_t bytes) {
+  /* The previous chunk is left with its free tail, the blocks never move */
+  if (s->nchunks == s->max_chunks) {
+    s->max_chunks *= 2;
+    s->chunks = (char **)realloc(s->chunks, s->max_chunks * sizeof(char *));
+    s->sizes = (size_t *)realloc(s->sizes, s->max_chunks * sizeof(size_t));
+    s->fds = (int *)realloc(s->fds, s->max_chunks * sizeof(int));
+  }
+
+  const size_t size = (bytes > s->chunk_size) ? bytes : s->chunk_size;
+  void *mem;
+  s->fds[s->nchunks] = -1;
+  if (s->dir != NULL) {
+    mem = slab_map_file(s, size, &s->fds[s->nchunks]);
+    if (mem == NULL) {
+      return 1;
+    }
+  } else if (posix_memalign(&mem, SLAB_ALIGN, size)) {
+    return 1;
+  }
+  s->chunks[s->nchunks] = (char *)mem;
+  s->sizes[s->nchunks] = size;
+  s->nchunks++;
+  s->used = 0;
+  s->bytes += size;
+  return 0;
+}
+
+void *slab_alloc(slab_t *s, const size_t bytes) {
+  const size_t size = (bytes + SLAB_ALIGN - 1) / SLAB_ALIGN * SLAB_ALIGN;
+  void *ptr = NULL;
+
+#pragma omp critical(slab)
+  {
+    if (s->nchunks > 0 && s->used + size <= s->sizes[s->nchunks - 1]) {
+      ptr = s->chunks[s->nchunks - 1] + s->used;
+      s->used += size;
+    } else if (!slab_grow(s, size)) {
+      ptr = s->chunks[s->nchunks - 1];
+      s->used = size;
+    }
+    if (ptr != NULL) {
+      s->bytes_used += size;
+    }
+  }
+  return ptr;
+}
+
+static char *slab_find(slab_t *s, const void *ptr, size_t *offset, size_t *size, int *fd) {
+  /*
+   * Chunk of <ptr> (NULL if it is not in the slab), its size, file and
+   * the offset of <ptr> in it. Copies taken under the lock : slab_grow()
+   * can move the tables as soon as it is released.
+   */
+  char *base = NULL;
+#pragma omp critical(slab)
+  {
+    for (int i = 0; i < s->nchunks; ++i) {
+      const char *p = (const char *)ptr;
+      if (p >= s->chunks[i] && p < s->chunks[i] + s->sizes[i]) {
+        base = s->chunks[i];
+        *offset = p - base;
+        *size = s->sizes[i];
+        *fd = s->fds[i];
+        break;
+      }
+    }
+  }
+  return base;
+}
+
+static void slab_page_range(const size_t offset, const size_t bytes, const size_t size, size_t *first, size_t *len) {
+  /* Pages holding [offset, offset + bytes) */
+  const size_t page = sysconf(_SC_PAGESIZE);
+  *first = offset / page * page;
+  const size_t last = (offset + bytes + page - 1) / page * page;
+  *len = ((last < size) ? last : size) - *first;
+}
+
+void slab_evict(slab_t *s, const void *ptr, const size_t bytes) {
+  size_t offset, size, first, len;
+  int fd;
+  char *base = (s->dir != NULL && ptr != NULL) ? slab_find(s, ptr, &offset, &size, &fd) : NULL;
+  if (base == NULL) {
+    return;
+  }
+  slab_page_range(offset, bytes, size, &first, &len);
+
+  /*
+   * Written back and dropped from the process and the page cache. The
+   * pages shared with other blocks are only read again on their next use.
+   */
+  msync(base + first, len, MS_SYNC);
+  madvise(base + first, len, MADV_DONTNEED);
+  posix_fadvise(fd, first, len, POSIX_FADV_DONTNEED);
+}
+
+void slab_prefetch(slab_t *s, const void *ptr, const size_t bytes) {
+  size_t offset, size, first, len;
+  int fd;
+  char *base = (s->dir != NULL && ptr != NULL) ? slab_find(s, ptr, &offset, &size, &fd) : NULL;
+  if (base == NULL) {
+    return;
+  }
+  slab_page_range(offset, bytes, size, &first, &len);
+  madvise(base + first, len, MADV_WILLNEED);
+}
+
+size_t slab_get_bytes(const slab_t *s) { return s->bytes; }
+
+size_t slab_get_used(const slab_t *s) { return s->bytes_used; }
+
+void slab_free(slab_t *s) {
+  for (int i = 0; i < s->nchunks; ++i) {
+    if (s->fds[i] >= 0) {
+      munmap(s->chunks[i], s->sizes[i]);
+      close(s->fds[i]);
+    } else {
+      free(s->chunks[i]);
+    }
+  }
+  free(s->chunks);
+  free(s->sizes);
+  free(s->fds);
+  free(s->dir);
+  s->chunks = NULL;
+  s->sizes = NULL;
+  s->fds = NULL;
+  s->dir = NULL;
+  s->nchunks = 0;
+  s->used = 0;
+  s->bytes = 0;
+}
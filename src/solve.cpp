@@ -27,18 +27,70 @@ using namespace std;
 
 template <int tdim>
 newton_t micropp<tdim>::newton_raphson(ell_matrix *A, double *b, double *u, double *du, const double strain[nvoi],
-                                       const double *vars_old) {
+                                       const vars_map *vars_old, const bool inexact, const bool reuse_A,
+                                       gp_telemetry *telem) {
   INST_START;
 
+  /* Telemetry : residuals and CG iterations while there is room, assembly and solve times */
+  double t_0 = wall_time(), t_asm = 0.0;
+  auto keep_residual = [telem](const double norm) {
+    if (telem != nullptr && telem->nresiduals < TELEM_MAX_ITS) telem->residuals[telem->nresiduals++] = norm;
+  };
+
   newton_t newton;
+  newton.assembled = reuse_A;
+
+  /* The finite difference tangents need the Newton solutions they start from */
+  const bool modified = nr_modified && inexact;
+
+#ifdef _OPENMP
+  const int tid = omp_get_thread_num();
+#else
+  const int tid = 0;
+#endif
+  assert(tid < num_solvers);  // see grow_solvers
+  ell_solver *solver = &solvers[tid];
+  defl_space *defl = (use_defl) ? &defls[tid] : nullptr;
 
   set_displ_bc(strain, u);
 
   int its = 0;
 
-  double norm = assembly_rhs(u, vars_old, b);
+  /*
+   * Fused assembly : the first residual and the jacobian of the first
+   * iteration come from one sweep if that iteration assembles. Only an
+   * initial guess that has already converged wastes the jacobian.
+   */
+  bool A_fresh = (nr_max_its > 0 && !reuse_A && (!use_A0 || its_with_A0 < 1));
+  double norm = (A_fresh) ? assembly_rhs_mat(A, u, vars_old, b, newton.stress)
+                          : assembly_rhs(u, vars_old, b, newton.stress);
+  keep_residual(norm);
+  if (telem != nullptr) {
+    telem->t_assembly += wall_time() - t_0;
+  }
 
   const double norm_0 = norm;
+  double norm_prev = norm;
+
+  const double cg_rel_tol = solver->rel_err;
+  const double norm_tol = (nr_max_tol > norm_0 * nr_rel_tol) ? nr_max_tol : norm_0 * nr_rel_tol;
+  double eta = cg_forcing_max;
+
+  /*
+   * BFGS pairs (s = du, y = b_old - b) of the iterations done with the
+   * current jacobian, applied with the two-loop recursion around the
+   * linear solve. They are dropped when the jacobian is reassembled.
+   */
+  int npairs = 0;
+  double *bfgs_s = nullptr, *bfgs_y = nullptr;
+  double bfgs_rho[NR_MAX_BFGS_PAIRS], bfgs_alpha[NR_MAX_BFGS_PAIRS];
+  const int max_pairs = (nr_max_its < NR_MAX_BFGS_PAIRS) ? nr_max_its : NR_MAX_BFGS_PAIRS;
+  if (nr_bfgs && modified) {
+    bfgs_s = get_work()->bfgs_s;
+    bfgs_y = get_work()->bfgs_y;
+  }
+  bool bfgs_pair = false;
+  bool defl_ok = false;
 
   while (its < nr_max_its) {
     if (norm < nr_max_tol || norm < norm_0 * nr_rel_tol) {
@@ -49,35 +101,147 @@ newton_t micropp<tdim>::newton_raphson(ell_matrix *A, double *b, double *u, doub
     /*
      * Matrix selection according if it's linear or non-linear.
      * All OpenMP threads can access to A0 with no cost because
-     * is a read-only matrix.
+     * is a read-only matrix, the mutable CG state is in <solver>.
+     * With <numa> each node reads its own replica.
      *
      */
-    ell_matrix *A_ptr;
+    double cg_err;
+    int cg_its;
+
+    /*
+     * Warm start : the last correction scaled with the last residual
+     * reduction is the initial guess of the CG for the new one
+     */
+    const bool use_x0 = cg_warm_start && its > 0;
+    if (use_x0) {
+      const double ratio = norm / norm_prev;
+      for (int i = 0; i < nn * dim; ++i) du[i] *= ratio;
+    }
+
+    /*
+     * Forcing term : loose CG solves while the Newton residual is large.
+     * Safeguards : eta does not fall much faster than in the previous
+     * iteration and does not oversolve the last one (Kelley, 1995)
+     */
+    if (cg_forcing && inexact) {
+      if (its > 0) {
+        const double eta_safe = cg_forcing_gamma * pow(eta, cg_forcing_alpha);
+        eta = cg_forcing_gamma * pow(norm / norm_prev, cg_forcing_alpha);
+        if (eta_safe > 0.1) eta = fmax(eta, eta_safe);
+        eta = fmin(fmax(eta, 0.5 * norm_tol / norm), cg_forcing_max);
+      }
+      solver->rel_err = fmax(eta, cg_rel_tol);
+    }
+
+    t_0 = wall_time();
+    t_asm = 0.0;
+
+    bfgs_pair = false;
     if (!use_A0 || its > (its_with_A0 - 1)) {
-      assembly_mat(A, u, vars_old);
-      A_ptr = A;
+      /*
+       * <reuse_A> : the first iteration keeps the jacobian of the previous
+       * solve. Modified Newton keeps it while the residual contracts.
+       */
+      const bool keep_A = newton.assembled && ((its == 0) ? reuse_A : modified && norm < nr_modified_rate * norm_prev);
+      if (!keep_A) {
+        if (!A_fresh) {
+          const double t_mat = wall_time();
+          assembly_mat(A, u, vars_old);
+          t_asm = wall_time() - t_mat;
+        }
+        npairs = 0;
+      }
+      A_fresh = false;
+      newton.assembled = true;
+
+      /* The deflation space of a kept jacobian is still valid */
+      if (use_defl && !(keep_A && defl_ok)) {
+        defl_ok = !defl_update(defl, A);
+      }
+
+      bfgs_pair = nr_bfgs && modified && npairs < max_pairs;
+      if (bfgs_pair) {
+        memcpy(&bfgs_y[npairs * nndim], b, nndim * sizeof(double));
+        for (int k = npairs - 1; k >= 0; --k) {
+          const double *s_k = &bfgs_s[k * nndim], *y_k = &bfgs_y[k * nndim];
+          double s_b = 0.0;
+          for (int i = 0; i < nndim; ++i) s_b += s_k[i] * b[i];
+          bfgs_alpha[k] = bfgs_rho[k] * s_b;
+          for (int i = 0; i < nndim; ++i) b[i] -= bfgs_alpha[k] * y_k[i];
+        }
+      }
+
+      if (use_A0_chol) {
+        cg_its = ell_solve_cg_chol(A, solver, &A0_chol, b, du, &cg_err);
+      } else if (use_defl && defl_ok) {
+        cg_its = ell_solve_dcg(A, solver, defl, b, du, &cg_err, use_x0);
+      } else {
+        cg_its = ell_solve_cgpd(A, solver, b, du, &cg_err, use_x0);
+      }
+
+      if (bfgs_pair) {
+        for (int k = 0; k < npairs; ++k) {
+          const double *s_k = &bfgs_s[k * nndim], *y_k = &bfgs_y[k * nndim];
+          double y_du = 0.0;
+          for (int i = 0; i < nndim; ++i) y_du += y_k[i] * du[i];
+          const double beta = bfgs_rho[k] * y_du;
+          for (int i = 0; i < nndim; ++i) du[i] += (bfgs_alpha[k] - beta) * s_k[i];
+        }
+        memcpy(&bfgs_s[npairs * nndim], du, nndim * sizeof(double));
+      }
+    } else if (use_A0_chol) {
+      /* Direct solve : two triangular solves with the factor of A0 */
+      chol_solve(&A0_chol, b, du, solver->Ap);
+      cg_its = 1;
+    } else if (use_defl) {
+      /* A0_defl is shared, the coarse scratch is the one of the thread */
+      cg_its = ell_solve_dcg(get_A0(), solver, &A0_defl, b, du, &cg_err, use_x0, defl->y);
     } else {
-#ifdef _OPENMP
-      int tid = omp_get_thread_num();
-#else
-      int tid = 0;
-#endif
-      A_ptr = &A0[tid];
+      cg_its = ell_solve_cgpd(get_A0(), solver, b, du, &cg_err, use_x0);
     }
 
-    double cg_err;
-    int cg_its = ell_solve_cgpd(A_ptr, b, du, &cg_err);
-
     newton.solver_its += cg_its;
+    if (telem != nullptr) {
+      if (telem->nsolves < TELEM_MAX_ITS) telem->solve_its[telem->nsolves] = cg_its;
+      telem->nsolves++;
+      telem->t_assembly += t_asm;
+      telem->t_solve += wall_time() - t_0 - t_asm;
+    }
 
     for (int i = 0; i < nn * dim; ++i) u[i] += du[i];
 
-    norm = assembly_rhs(u, vars_old, b);
+    norm_prev = norm;
+    t_0 = wall_time();
+    norm = assembly_rhs(u, vars_old, b, newton.stress);
+    keep_residual(norm);
+    if (telem != nullptr) {
+      telem->t_assembly += wall_time() - t_0;
+    }
+
+    if (bfgs_pair) {
+      double *s_k = &bfgs_s[npairs * nndim], *y_k = &bfgs_y[npairs * nndim];
+      double s_y = 0.0;
+      for (int i = 0; i < nndim; ++i) {
+        y_k[i] -= b[i];
+        s_y += s_k[i] * y_k[i];
+      }
+      /* Curvature condition */
+      if (s_y > 0.0) {
+        bfgs_rho[npairs++] = 1.0 / s_y;
+      }
+    }
 
     its++;
   }
 
+  solver->rel_err = cg_rel_tol;
+
   newton.its = its;
+  if (telem != nullptr) {
+    telem->newton_its += its;
+    telem->solver_its += newton.solver_its;
+  }
+  INST_ITS(its);
   return newton;
 }
 
@@ -0,0 +1,92 @@
+/*
+ *  This source code is part of MicroPP: a finite element library
+ *  to solve microstructural problems for composite materials.
+ *
+ *  Copyright (C) - 2018 - Guido Giuntoli <gagiuntoli@gmail.com>
+ *						   Jimmy Aguilar Mena <kratsbinovish@gmail.com>
+ *                         Judicaël Grasset <judicael.grasset@stfc.ac.uk>
+ *                         Alejandro Figueroa <afiguer7@maisonlive.gmu.edu>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published
+ *  by the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "topology.hpp"
+
+#include <sched.h>
+
+#include <cstdio>
+#include <cstdlib>
+
+#define TOPO_MAX_NODES 64
+
+static int topo_read_cpulist(topo_t *t, const int node) {
+  /* Ranges of the form "0-7,16-23" */
+  char path[128];
+  snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", node);
+  FILE *file = fopen(path, "r");
+  if (file == NULL) {
+    return 1;
+  }
+
+  int first, last;
+  while (fscanf(file, "%d", &first) == 1) {
+    last = first;
+    int c = fgetc(file);
+    if (c == '-') {
+      if (fscanf(file, "%d", &last) != 1) {
+        break;
+      }
+      c = fgetc(file);
+    }
+    if (last >= t->ncpus) {
+      const int ncpus = last + 1;
+      t->cpu_node = (int *)realloc(t->cpu_node, ncpus * sizeof(int));
+      for (int i = t->ncpus; i < ncpus; ++i) t->cpu_node[i] = 0;
+      t->ncpus = ncpus;
+    }
+    for (int cpu = first; cpu <= last; ++cpu) t->cpu_node[cpu] = node;
+    if (c != ',') {
+      break;
+    }
+  }
+  fclose(file);
+  return 0;
+}
+
+int topo_init(topo_t *t) {
+  t->nnodes = 0;
+  t->ncpus = 0;
+  t->cpu_node = NULL;
+
+  /* Node ids are dense on the systems we run, a gap ends the search */
+  while (t->nnodes < TOPO_MAX_NODES && !topo_read_cpulist(t, t->nnodes)) {
+    t->nnodes++;
+  }
+
+  if (t->nnodes == 0) {
+    t->nnodes = 1;
+    return 1;
+  }
+  return 0;
+}
+
+int topo_get_node(const topo_t *t) {
+  const int cpu = sched_getcpu();
+  return (cpu >= 0 && cpu < t->ncpus) ? t->cpu_node[cpu] : 0;
+}
+
+void topo_free(topo_t *t) {
+  free(t->cpu_node);
+  t->cpu_node = NULL;
+}
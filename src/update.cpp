@@ -26,28 +26,47 @@
 
 /*
  * Evolutes the internal variables for the non-linear material models
- * Calculates the <f_trial_max> max value.
+ * into <vars_new>, that is refilled. Only the elements with history in
+ * <vars_old> or with a non-linear Gauss point now get a block, for the
+ * rest the evolution from the virgin state is the virgin state again.
+ * Returns <true> if some Gauss point is non-linear.
  */
 
 template <int tdim>
-bool micropp<tdim>::calc_vars_new(const double *u, const double *_vars_old, double *_vars_new) const {
+bool micropp<tdim>::calc_vars_new(const double *u, const vars_map *vars_old, vars_map *vars_new) const {
   bool non_linear = false;
+  const double zeros[NUM_VAR_GP] = {0.0};
+
+  vars_clear(vars_new);
 
   for (int ez = 0; ez < nez; ++ez) {
     for (int ey = 0; ey < ney; ++ey) {
       for (int ex = 0; ex < nex; ++ex) {
         const int e = glo_elem(ex, ey, ez);
         const material_t *material = get_material(e);
+        const int nvar = material->get_nvars();
+        if (nvar == 0) {
+          continue;
+        }
+
+        const bool history = (vars_old != nullptr && vars_old->off[e] >= 0);
+        double vars_e[npe * NUM_VAR_GP] = {0.0};
+        bool non_linear_e = false;
 
         for (int gp = 0; gp < npe; ++gp) {
-          const double *vars_old = (_vars_old) ? &_vars_old[intvar_ix(e, gp, 0)] : nullptr;
-          double *vars_new = &_vars_new[intvar_ix(e, gp, 0)];
+          /* A linear GP (no <vars_old>) keeps passing nullptr to the materials */
+          const double *vars_gp_old = (history) ? vars_get(vars_old, e, gp, nvar) : (vars_old) ? zeros : nullptr;
 
           double eps[nvoi];
           get_strain(u, gp, eps, bmat, nx, ny, ex, ey, ez);
 
-          non_linear |= material->evolute(eps, vars_old, vars_new);
+          non_linear_e |= material->evolute(eps, vars_gp_old, &vars_e[gp * nvar]);
+        }
+
+        if (history || non_linear_e) {
+          memcpy(vars_add(vars_new, e, nvar), vars_e, npe * nvar * sizeof(double));
         }
+        non_linear |= non_linear_e;
       }
     }
   }
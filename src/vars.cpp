@@ -0,0 +1,113 @@
+/*
+ *  This source code is part of MicroPP: a finite element library
+ *  to solve microstructural problems for composite materials.
+ *
+ *  Copyright (C) - 2018 - Guido Giuntoli <gagiuntoli@gmail.com>
+ *						   Jimmy Aguilar Mena <kratsbinovish@gmail.com>
+ *                         Judicaël Grasset <judicael.grasset@stfc.ac.uk>
+ *                         Alejandro Figueroa <afiguer7@maisonlive.gmu.edu>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Lesser General Public License as published
+ *  by the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU Lesser General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "vars.hpp"
+
+#include <cstdlib>
+#include <cstring>
+
+static double *vars_alloc_vals(vars_map *m, const long capacity) {
+  return (m->slab != NULL) ? (double *)slab_alloc(m->slab, capacity * sizeof(double))
+                           : (double *)malloc(capacity * sizeof(double));
+}
+
+int vars_init(vars_map *m, const int nelem, const int npe, slab_t *slab) {
+  m->nelem = nelem;
+  m->npe = npe;
+  m->nactive = 0;
+  m->size = 0;
+  m->capacity = 0;
+  m->vals = NULL;
+  m->slab = slab;
+  m->off = (slab != NULL) ? (long *)slab_alloc(slab, nelem * sizeof(long)) : (long *)malloc(nelem * sizeof(long));
+  if (m->off == NULL) {
+    return 1;
+  }
+  for (int e = 0; e < nelem; ++e) m->off[e] = -1;
+  return 0;
+}
+
+void vars_clear(vars_map *m) {
+  /* Keeps the memory of <vals> for the next fill */
+  for (int e = 0; e < m->nelem; ++e) m->off[e] = -1;
+  m->nactive = 0;
+  m->size = 0;
+}
+
+double *vars_add(vars_map *m, const int e, const int nvar) {
+  /* Block of element <e>, appended if it does not exist yet */
+  if (m->off[e] >= 0) {
+    return &m->vals[m->off[e]];
+  }
+
+  const long blk_size = (long)m->npe * nvar;
+  if (m->size + blk_size > m->capacity) {
+    long capacity = (m->capacity > 0) ? 2 * m->capacity : 64 * blk_size;
+    while (capacity < m->size + blk_size) capacity *= 2;
+    if (m->slab != NULL) {
+      double *vals = vars_alloc_vals(m, capacity);
+      if (m->size > 0) {
+        memcpy(vals, m->vals, m->size * sizeof(double));
+      }
+      m->vals = vals;
+    } else {
+      m->vals = (double *)realloc(m->vals, capacity * sizeof(double));
+    }
+    m->capacity = capacity;
+  }
+
+  m->off[e] = m->size;
+  m->size += blk_size;
+  m->nactive++;
+  return &m->vals[m->off[e]];
+}
+
+void vars_reserve(vars_map *m, const long capacity) {
+  /* Room for <capacity> values, the current ones are not kept */
+  if (m->capacity < capacity) {
+    if (m->slab == NULL) {
+      free(m->vals);
+    }
+    m->vals = vars_alloc_vals(m, capacity);
+    m->capacity = capacity;
+  }
+}
+
+void vars_copy(vars_map *dst, const vars_map *src) {
+  vars_reserve(dst, src->size);
+  memcpy(dst->off, src->off, src->nelem * sizeof(long));
+  memcpy(dst->vals, src->vals, src->size * sizeof(double));
+  dst->nactive = src->nactive;
+  dst->size = src->size;
+}
+
+long vars_get_bytes(const vars_map *m) { return m->nelem * sizeof(long) + m->capacity * sizeof(double); }
+
+void vars_free(vars_map *m) {
+  if (m->slab == NULL) {
+    free(m->off);
+    free(m->vals);
+  }
+  m->off = NULL;
+  m->vals = NULL;
+}
@@ -49,7 +49,7 @@ class test_t : public micropp<3> {
 
 			ell_matrix A;  // Jacobian
 			const int ns[3] = { nx, ny, nz };
-			ell_init(&A, dim, dim, ns, CG_ABS_TOL, CG_REL_TOL, CG_MAX_ITS);
+			ell_init(&A, dim, dim, ns);
 			double *b = (double *) calloc(nndim, sizeof(double));
 			double *du = (double *) calloc(nndim, sizeof(double));
 			double *u = (double *) calloc(nndim, sizeof(double));
@@ -75,9 +75,9 @@ class test_t : public micropp<3> {
 			auto time_4 = high_resolution_clock::now();
 			auto time_5 = high_resolution_clock::now();
 #ifdef _OPENACC
-			int cg_its = ell_solve_cgpd_acc(&A, b, du, &cg_err);
+			int cg_its = ell_solve_cgpd_acc(&A, &solvers[0], b, du, &cg_err);
 #else
-			int cg_its = ell_solve_cgpd(&A, b, du, &cg_err);
+			int cg_its = ell_solve_cgpd(&A, &solvers[0], b, du, &cg_err);
 #endif
 			auto time_6 = high_resolution_clock::now();
 
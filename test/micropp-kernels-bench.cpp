@@ -0,0 +1,475 @@
+/*
+ *  This is a test example for MicroPP: a finite element library
+ *  to solve microstructural problems for composite materials.
+ *
+ *  Copyright (C) - 2018 - Jimmy Aguilar Mena <kratsbinovish@gmail.com>
+ *                         Guido Giuntoli <gagiuntoli@gmail.com>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <iostream>
+#include <cassert>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+#include "micropp.hpp"
+
+using namespace std;
+
+/*
+ * Kernel benchmark with roofline reporting
+ *
+ * micropp-kernels-bench [n,...] [threads,...] [min_time] [file.json]
+ *
+ * Each kernel runs on <threads> threads at once, every thread on its own
+ * RVE data as the GPs are homogenized, and the rates are the aggregate of
+ * all of them. They are compared with the ceilings measured on the same
+ * threads : STREAM triad bandwidth and the peak of independent multiply
+ * adds (for the instruction set of this build). The bytes are the
+ * compulsory traffic (each array moved once), the flops are counted from
+ * the code. Build with CMAKE_BUILD_TYPE=Release for meaningful numbers.
+ * A <min_time> under 0.1 s (as ctest runs it) only checks that it works,
+ * the bandwidth is then measured on arrays that may fit in the cache.
+ */
+
+#define BENCH_TRIALS 3       // best of
+#define BENCH_CG_ITS 20      // CG iterations of the timed solve (minus a solve of 1)
+#define PROBE_LANES 32       // independent multiply adds of the peak FLOP probe
+#define PROBE_MIN_DOUBLES (1L << 22)
+#define PROBE_MAX_DOUBLES (1L << 25)
+#define PROBE_QUICK_TIME 0.1          // shorter min_time (the run of ctest) : only a smoke test of the probe
+#define PROBE_QUICK_DOUBLES (1L << 20)
+
+static int get_thread()
+{
+#ifdef _OPENMP
+	return omp_get_thread_num();
+#else
+	return 0;
+#endif
+}
+
+/* Runs <kernel> <reps> times on each thread at once, seconds of the slowest one */
+template <typename F>
+static double run_threads(const int nthreads, const long reps, F kernel)
+{
+	double t_max = 0.0;
+#pragma omp parallel num_threads(nthreads) reduction(max : t_max)
+	{
+		const int tid = get_thread();
+#pragma omp barrier
+		const double t_0 = wall_time();
+		for (long r = 0; r < reps; ++r)
+			kernel(tid);
+		t_max = wall_time() - t_0;
+	}
+	return t_max;
+}
+
+/* Seconds of one call : enough repetitions for <min_time>, best of BENCH_TRIALS */
+template <typename F>
+static double time_kernel(const int nthreads, const double min_time, F kernel)
+{
+	const double t_1 = run_threads(nthreads, 1, kernel);
+	const long reps = max(1L, (long)(min_time / max(t_1, 1.0e-9)));
+	double best = t_1;
+	for (int trial = 0; trial < BENCH_TRIALS; ++trial)
+		best = min(best, run_threads(nthreads, reps, kernel) / reps);
+	return best;
+}
+
+typedef struct {
+	int threads;
+	double copy, scale, add, triad;  // GB/s
+	double peak;                     // GFLOP/s
+} probe_t;
+
+typedef struct {
+	string kernel;
+	int n;
+	int threads;
+	double seconds;  // per call and thread
+	double bytes;    // per call
+	double flops;    // per call
+} result_t;
+
+static probe_t run_probe(const int nthreads, const double min_time)
+{
+	/*
+	 * STREAM arrays out of the last level cache (bounded for very large
+	 * ones), 3 x 8 MB for the quick runs
+	 */
+	long llc = 0;
+#ifdef _SC_LEVEL3_CACHE_SIZE
+	llc = sysconf(_SC_LEVEL3_CACHE_SIZE);
+#endif
+	long n = min(PROBE_MAX_DOUBLES, max(PROBE_MIN_DOUBLES, 4 * llc / (long)sizeof(double)));
+	if (min_time < PROBE_QUICK_TIME)
+		n = PROBE_QUICK_DOUBLES;
+	double *a = (double *)malloc(n * sizeof(double));
+	double *b = (double *)malloc(n * sizeof(double));
+	double *c = (double *)malloc(n * sizeof(double));
+	const double s = 3.0;
+
+#pragma omp parallel for num_threads(nthreads) schedule(static)
+	for (long i = 0; i < n; ++i) {
+		a[i] = 1.0;
+		b[i] = 2.0;
+		c[i] = 0.0;
+	}
+
+	auto stream = [&](const int op) {
+		double best = 1.0e30;
+		for (int trial = 0; trial < BENCH_TRIALS + 2; ++trial) {
+			const double t_0 = wall_time();
+#pragma omp parallel for num_threads(nthreads) schedule(static)
+			for (long i = 0; i < n; ++i) {
+				if (op == 0)
+					c[i] = a[i];
+				else if (op == 1)
+					b[i] = s * c[i];
+				else if (op == 2)
+					c[i] = a[i] + b[i];
+				else
+					a[i] = b[i] + s * c[i];
+			}
+			best = min(best, wall_time() - t_0);
+		}
+		return ((op < 2) ? 2 : 3) * n * sizeof(double) / best / 1.0e9;
+	};
+
+	probe_t probe;
+	probe.threads = nthreads;
+	probe.copy = stream(0);
+	probe.scale = stream(1);
+	probe.add = stream(2);
+	probe.triad = stream(3);
+	free(a);
+	free(b);
+	free(c);
+
+	/* Peak : PROBE_LANES chains of x = x * a + c per thread */
+	vector<double> sink(nthreads);
+	long iters = 1 << 16;
+	double t_probe = 0.0;
+	while (true) {
+		t_probe = run_threads(nthreads, 1, [&](const int tid) {
+			double x[PROBE_LANES];
+			for (int k = 0; k < PROBE_LANES; ++k)
+				x[k] = 1.0 + k * 1.0e-3;
+			for (long it = 0; it < iters; ++it)
+				for (int k = 0; k < PROBE_LANES; ++k)
+					x[k] = x[k] * 0.999999 + 1.0e-7;
+			double sum = 0.0;
+			for (int k = 0; k < PROBE_LANES; ++k)
+				sum += x[k];
+			sink[tid] = sum;
+		});
+		if (t_probe > min_time)
+			break;
+		iters *= 2;
+	}
+	probe.peak = nthreads * 2.0 * PROBE_LANES * iters / t_probe / 1.0e9;
+	assert(sink[0] > 0.0);
+
+	return probe;
+}
+
+class bench_t : public micropp<3> {
+
+	public:
+		bench_t(const micropp_params_t &mic_params) : micropp<3>(mic_params) {};
+
+		void run(const int nthreads, const double min_time, vector<result_t> &results)
+		{
+			const int ns[3] = { nx, ny, nz };
+			const double strain[6] = { 1.0e-3, -2.0e-4, 0.0, 5.0e-4, 0.0, 0.0 };
+			constexpr int npedim = npe * dim;
+
+			/* Data of each thread, first touched by it */
+			vector<ell_matrix> A(nthreads);
+			vector<ell_solver> solver(nthreads);
+			vector<double *> u(nthreads), b(nthreads), x(nthreads), Ae(nthreads);
+
+#pragma omp parallel num_threads(nthreads)
+			{
+				const int tid = get_thread();
+				A[tid] = ell_matrix();
+				ell_init(&A[tid], dim, dim, ns);
+				ell_solver_init(&solver[tid], nndim);
+				solver[tid].min_err = 1.0e-300;
+				solver[tid].rel_err = 0.0;
+				u[tid] = (double *)calloc(nndim, sizeof(double));
+				b[tid] = (double *)calloc(nndim, sizeof(double));
+				x[tid] = (double *)calloc(nndim, sizeof(double));
+				Ae[tid] = (double *)calloc(npedim * npedim, sizeof(double));
+				set_displ_bc(strain, u[tid]);
+				assembly_mat(&A[tid], u[tid], nullptr);
+				assembly_rhs(u[tid], nullptr, b[tid]);
+			}
+
+			const double nrow = nndim, nnz = A[0].nnz;
+			const double mvp_bytes = nrow * nnz * (sizeof(int) + sizeof(double)) + 2 * nrow * sizeof(double);
+
+			/* Per Gauss point : strain, B^T sigma, C B and B^T (C B), elastic laws */
+			const double flops_strain = 2.0 * nvoi * npedim;
+			const double flops_rhs = npe * (flops_strain + 3.0 * nvoi * npedim + 21);
+			const double flops_mat = npe * (flops_strain + nvoi * npedim * (2.0 * nvoi + 1) +
+							2.0 * nvoi * npedim * npedim + 15);
+
+			result_t res;
+			res.n = nx;
+			res.threads = nthreads;
+
+			res.kernel = "ell_mvp";
+			res.seconds = time_kernel(nthreads, min_time, [&](const int tid) {
+				ell_mvp(&A[tid], u[tid], x[tid]);
+			});
+			res.bytes = mvp_bytes;
+			res.flops = 2.0 * nrow * nnz;
+			results.push_back(res);
+
+			/* One CG iteration : the difference of BENCH_CG_ITS and 1 iterations */
+			double cg_err;
+			double t_cg[2];
+			const int cg_its[2] = { BENCH_CG_ITS, 1 };
+			for (int i = 0; i < 2; ++i) {
+				for (int t = 0; t < nthreads; ++t)
+					solver[t].max_its = cg_its[i];
+				t_cg[i] = time_kernel(nthreads, min_time, [&](const int tid) {
+					ell_solve_cgpd(&A[tid], &solver[tid], b[tid], x[tid], &cg_err);
+				});
+			}
+			res.kernel = "ell_solve_cgpd_it";
+			res.seconds = max(t_cg[0] - t_cg[1], 1.0e-12) / (BENCH_CG_ITS - 1);
+			res.bytes = mvp_bytes + 136.0 * nrow;
+			res.flops = 2.0 * nrow * nnz + 13.0 * nrow;
+			results.push_back(res);
+
+			res.kernel = "assembly_rhs";
+			res.seconds = time_kernel(nthreads, min_time, [&](const int tid) {
+				assembly_rhs(u[tid], nullptr, b[tid]);
+			});
+			res.bytes = 3.0 * nndim * sizeof(double) + nelem * sizeof(int);
+			res.flops = nelem * flops_rhs;
+			results.push_back(res);
+
+			res.kernel = "assembly_mat";
+			res.seconds = time_kernel(nthreads, min_time, [&](const int tid) {
+				assembly_mat(&A[tid], u[tid], nullptr);
+			});
+			res.bytes = 2.0 * nrow * nnz * sizeof(double) + nndim * sizeof(double) + nelem * sizeof(int);
+			res.flops = nelem * flops_mat;
+			results.push_back(res);
+
+			res.kernel = "get_elem_mat";
+			res.seconds = time_kernel(nthreads, min_time, [&](const int tid) {
+				for (int ez = 0; ez < nez; ++ez)
+					for (int ey = 0; ey < ney; ++ey)
+						for (int ex = 0; ex < nex; ++ex)
+							get_elem_mat(u[tid], nullptr, Ae[tid], ex, ey, ez);
+			});
+			res.bytes = nelem * (npedim * sizeof(double) + sizeof(int));
+			res.flops = nelem * flops_mat;
+			results.push_back(res);
+
+			for (int t = 0; t < nthreads; ++t) {
+				ell_free(&A[t]);
+				ell_solver_free(&solver[t]);
+				free(u[t]);
+				free(b[t]);
+				free(x[t]);
+				free(Ae[t]);
+			}
+		}
+
+		void run_materials(const int nthreads, const double min_time, vector<result_t> &results)
+		{
+			/* One call per Gauss point of the RVE, strains in the non-linear range */
+			const int npts = nelem * npe;
+			const char *names[3] = { "elastic", "plastic", "damage" };
+
+			/* Flops of the branch taken, sqrt and divisions as 1 */
+			const double flops[3][3] = { { 21, 15, 0 }, { 103, 793, 81 }, { 58, 478, 46 } };
+
+			material_base bases[3];
+			material_set(&bases[0], 0, 1.0e7, 0.3, 0.0, 0.0, 0.0);
+			material_set(&bases[1], 1, 1.0e7, 0.3, 1.0e4, 5.0e4, 0.0);
+			material_set(&bases[2], 2, 1.0e7, 0.3, 0.0, 0.0, 1.0e4);
+
+			vector<double *> eps(nthreads), out(nthreads), vars_old(nthreads), vars_new(nthreads);
+#pragma omp parallel num_threads(nthreads)
+			{
+				const int tid = get_thread();
+				eps[tid] = (double *)malloc(npts * 6 * sizeof(double));
+				out[tid] = (double *)malloc(npts * 36 * sizeof(double));
+				vars_old[tid] = (double *)calloc(npts * NUM_VAR_GP, sizeof(double));
+				vars_new[tid] = (double *)calloc(npts * NUM_VAR_GP, sizeof(double));
+				for (int p = 0; p < npts; ++p)
+					for (int i = 0; i < 6; ++i)
+						eps[tid][p * 6 + i] = 1.0e-2 * (1.0 + 0.1 * ((p + i) % 7)) * ((i < 3) ? 1.0 : 0.5);
+			}
+
+			for (int m = 0; m < 3; ++m) {
+				const material_t *material = material_t::make_material(bases[m]);
+				const int nvar = material->get_nvars();
+				const double *no_vars = nullptr;
+				const char *ops[3] = { "get_stress", "get_ctan", "evolute" };
+				const double out_bytes[3] = { 6 * sizeof(double), 36 * sizeof(double),
+					(double)(nvar * sizeof(double)) };
+
+				for (int op = 0; op < 3; ++op) {
+					const double seconds = time_kernel(nthreads, min_time, [&](const int tid) {
+						for (int p = 0; p < npts; ++p) {
+							const double *e = &eps[tid][p * 6];
+							const double *v_old = (nvar > 0) ? &vars_old[tid][p * NUM_VAR_GP] : no_vars;
+							if (op == 0)
+								material->get_stress(e, &out[tid][p * 36], v_old);
+							else if (op == 1)
+								material->get_ctan(e, &out[tid][p * 36], v_old);
+							else
+								material->evolute(e, v_old, &vars_new[tid][p * NUM_VAR_GP]);
+						}
+					});
+
+					result_t res;
+					res.kernel = string(names[m]) + "." + ops[op];
+					res.n = nx;
+					res.threads = nthreads;
+					res.seconds = seconds;
+					res.bytes = npts * (6 * sizeof(double) + nvar * sizeof(double) + out_bytes[op]);
+					res.flops = npts * flops[m][op];
+					results.push_back(res);
+				}
+				delete material;
+			}
+
+			for (int t = 0; t < nthreads; ++t) {
+				free(eps[t]);
+				free(out[t]);
+				free(vars_old[t]);
+				free(vars_new[t]);
+			}
+		}
+};
+
+static vector<int> parse_list(const char *arg)
+{
+	vector<int> list;
+	stringstream ss(arg);
+	string item;
+	while (getline(ss, item, ','))
+		list.push_back(atoi(item.c_str()));
+	return list;
+}
+
+int main (int argc, char *argv[])
+{
+	int max_threads = 1;
+#ifdef _OPENMP
+	max_threads = omp_get_max_threads();
+#endif
+
+	vector<int> n_list = parse_list((argc > 1) ? argv[1] : "8,16,24");
+	vector<int> thread_list;
+	if (argc > 2) {
+		thread_list = parse_list(argv[2]);
+	} else {
+		for (int t = 1; t < max_threads; t *= 2)
+			thread_list.push_back(t);
+		thread_list.push_back(max_threads);
+	}
+	const double min_time = (argc > 3) ? atof(argv[3]) : 0.2;
+	const char *filename = (argc > 4) ? argv[4] : "micropp-kernels-bench.json";
+
+	for (const int n : n_list)
+		assert(n > 2);
+	for (const int t : thread_list)
+		assert(t > 0 && t <= max_threads);
+
+	micropp_params_t mic_params;
+	mic_params.ngp = 1;
+	mic_params.type = MIC_SPHERE;
+	mic_params.calc_ctan_lin = false;
+	material_set(&mic_params.materials[0], 0, 1.0e7, 0.3, 0.0, 0.0, 0.0);
+	material_set(&mic_params.materials[1], 0, 1.0e8, 0.3, 0.0, 0.0, 0.0);
+	material_set(&mic_params.materials[2], 0, 1.0e8, 0.3, 0.0, 0.0, 0.0);
+
+	vector<probe_t> probes;
+	vector<result_t> results;
+
+	for (const int t : thread_list) {
+		probes.push_back(run_probe(t, min_time));
+		for (const int n : n_list) {
+			mic_params.size[0] = n;
+			mic_params.size[1] = n;
+			mic_params.size[2] = n;
+			bench_t bench(mic_params);
+			bench.run(t, min_time, results);
+			bench.run_materials(t, min_time, results);
+		}
+	}
+
+	ofstream file(filename);
+	file << "{\n\"probe\": [\n";
+	for (size_t i = 0; i < probes.size(); ++i) {
+		const probe_t &p = probes[i];
+		file << "  {\"threads\": " << p.threads << ", \"copy_gbs\": " << p.copy << ", \"scale_gbs\": " << p.scale
+		     << ", \"add_gbs\": " << p.add << ", \"triad_gbs\": " << p.triad << ", \"peak_gflops\": " << p.peak
+		     << "}" << ((i + 1 < probes.size()) ? ",\n" : "\n");
+	}
+	file << "],\n\"kernels\": [\n";
+
+	cout << setw(28) << left << "kernel" << right << setw(6) << "n" << setw(8) << "threads" << setw(12) << "GB/s"
+	     << setw(12) << "GFLOP/s" << setw(12) << "roof %" << endl;
+
+	for (size_t i = 0; i < results.size(); ++i) {
+		const result_t &r = results[i];
+		const probe_t *p = &probes[0];
+		for (const probe_t &q : probes)
+			if (q.threads == r.threads)
+				p = &q;
+
+		/* Aggregate of the threads, the roofline of the same threads */
+		const double gbs = r.threads * r.bytes / r.seconds / 1.0e9;
+		const double gflops = r.threads * r.flops / r.seconds / 1.0e9;
+		const double ai = r.flops / r.bytes;
+		const double roof = min(p->peak, ai * p->triad);
+
+		/* Kernels without flops only have the bandwidth roof */
+		const double frac = (r.flops > 0) ? gflops / roof : gbs / p->triad;
+
+		file << "  {\"kernel\": \"" << r.kernel << "\", \"n\": " << r.n << ", \"threads\": " << r.threads
+		     << ", \"seconds\": " << r.seconds << ", \"bytes\": " << r.bytes << ", \"flops\": " << r.flops
+		     << ", \"gbs\": " << gbs << ", \"gflops\": " << gflops << ", \"intensity\": " << ai
+		     << ", \"roofline_gflops\": " << roof << ", \"roofline_fraction\": " << frac << "}"
+		     << ((i + 1 < results.size()) ? ",\n" : "\n");
+
+		cout << setw(28) << left << r.kernel << right << setw(6) << r.n << setw(8) << r.threads << setw(12)
+		     << gbs << setw(12) << gflops << setw(12) << 100.0 * frac << endl;
+	}
+	file << "]\n}\n";
+	file.close();
+
+	cout << "written " << filename << endl;
+	return 0;
+}
@@ -142,7 +142,9 @@ program test3d_3
         end do
 
         call micropp3_write_restart(micro, 16)
-        call micropp3_read_restart(micro, 16)
+        if (micropp3_read_restart(micro, 16) /= 0) then
+                write(*,*) "restart 16 not read"
+        end if
         call micropp3_free(micro)
 
 end program test3d_3
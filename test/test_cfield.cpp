@@ -0,0 +1,125 @@
+/*
+ *  This is a test example for MicroPP: a finite element library
+ *  to solve microstructural problems for composite materials.
+ *
+ *  Copyright (C) - 2018 - Jimmy Aguilar Mena <kratsbinovish@gmail.com>
+ *                         Guido Giuntoli <gagiuntoli@gmail.com>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <iostream>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+
+#include "cfield.hpp"
+#include "micropp.hpp"
+
+using namespace std;
+
+#define NGP 2
+#define STEPS 3
+
+/* Homogenizes STEPS steps of a plastic RVE keeping u with <u_storage> */
+static void homogenize(const int u_storage, double sig[NGP][6], double ctan[NGP][36])
+{
+	const int n = 6;
+	micropp_params_t mic_params;
+
+	int coupling[NGP] = { FE_ONE_WAY, FE_FULL };
+	mic_params.ngp = NGP;
+	mic_params.size[0] = n;
+	mic_params.size[1] = n;
+	mic_params.size[2] = n;
+	mic_params.type = MIC_SPHERE;
+	mic_params.coupling = coupling;
+	mic_params.lin_stress = false;
+	mic_params.u_storage = u_storage;
+	material_set(&mic_params.materials[0], 1, 1.0e7, 0.3, 1.0e4, 5.0e4, 0.0);
+	material_set(&mic_params.materials[1], 0, 1.0e8, 0.3, 0.0, 0.0, 0.0);
+	material_set(&mic_params.materials[2], 0, 1.0e8, 0.3, 0.0, 0.0, 0.0);
+
+	micropp<3> micro(mic_params);
+	double eps[6] = { 0.0 };
+	for (int t = 0; t < STEPS; ++t) {
+		eps[0] += 3.0e-3;
+		eps[4] += 1.0e-3;
+		for (int gp = 0; gp < NGP; ++gp)
+			micro.set_strain(gp, eps);
+		micro.homogenize();
+		micro.update_vars();
+	}
+	assert(micro.get_non_linear_gps() == NGP);
+
+	for (int gp = 0; gp < NGP; ++gp) {
+		micro.get_stress(gp, sig[gp]);
+		micro.get_ctan(gp, ctan[gp]);
+	}
+}
+
+int main (int argc, char *argv[])
+{
+	const int n = 3 * 1000;
+	double *ref = (double *)malloc(n * sizeof(double));
+	double *v = (double *)malloc(n * sizeof(double));
+	double *w = (double *)malloc(n * sizeof(double));
+
+	/* Affine reference plus a small smooth fluctuation, zero on every 5th node */
+	for (int i = 0; i < n; ++i) {
+		ref[i] = 1.0e-3 * (i / 3) / 1000.0;
+		v[i] = ref[i] + (((i / 3) % 5) ? 1.0e-5 * sin(0.01 * i) : 0.0);
+	}
+
+	cfield c;
+	cfield_init(&c);
+
+	/* An empty field leaves the output untouched */
+	w[0] = 7.0;
+	cfield_unpack(&c, ref, w);
+	assert(w[0] == 7.0);
+
+	cfield_pack(&c, v, ref, n, 3, 0.0);
+	cfield_unpack(&c, ref, w);
+	for (int i = 0; i < n; ++i)
+		assert(w[i] == v[i]);
+	assert(c.size < (long)(n * sizeof(double)));
+	cout << "lossless [B] : " << c.size << " / " << n * sizeof(double) << endl;
+
+	const double tol = 1.0e-6;
+	cfield_pack(&c, v, ref, n, 3, tol);
+	cfield_unpack(&c, ref, w);
+	double max_d = 0.0, max_err = 0.0;
+	for (int i = 0; i < n; ++i) {
+		max_d = fmax(max_d, fabs(v[i] - ref[i]));
+		max_err = fmax(max_err, fabs(w[i] - v[i]));
+	}
+	assert(max_err <= 0.5 * tol * max_d * (1 + 1.0e-6));
+	assert(c.size < (long)(n * sizeof(double) / 2));
+	cout << "lossy    [B] : " << c.size << " / " << n * sizeof(double) << endl;
+
+	cfield_free(&c);
+	free(ref);
+	free(v);
+	free(w);
+
+	/* End to end : U_LOSSLESS gives the results of U_PLAIN bit by bit */
+	double sig[2][NGP][6], ctan[2][NGP][36];
+	homogenize(U_PLAIN, sig[0], ctan[0]);
+	homogenize(U_LOSSLESS, sig[1], ctan[1]);
+	assert(memcmp(sig[0], sig[1], sizeof(sig[0])) == 0);
+	assert(memcmp(ctan[0], ctan[1], sizeof(ctan[0])) == 0);
+
+	return 0;
+}
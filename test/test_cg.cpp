@@ -50,7 +50,7 @@ int main (int argc, char *argv[])
 				const int nfield = dim;
 
 				ell_matrix A;  // Jacobian
-				ell_init(&A, nfield, dim, ns, CG_ABS_TOL, CG_REL_TOL, CG_MAX_ITS);
+				ell_init(&A, nfield, dim, ns);
 				double *b = (double *) calloc(nndim, sizeof(double));
 				double *du = (double *) calloc(nndim, sizeof(double));
 				double *u = (double *) calloc(nndim, sizeof(double));
@@ -62,7 +62,7 @@ int main (int argc, char *argv[])
 				lerr = assembly_rhs(u, nullptr, b);
 
 				assembly_mat(&A, u, nullptr);
-				int cg_its = ell_solve_cgpd(&A, b, du, &cg_err);
+				int cg_its = ell_solve_cgpd(&A, &solvers[0], b, du, &cg_err);
 
 				for (int i = 0; i < nndim; ++i)
 					u[i] += du[i];
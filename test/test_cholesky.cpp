@@ -0,0 +1,128 @@
+/*
+ *  This is a test example for MicroPP: a finite element library
+ *  to solve microstructural problems for composite materials.
+ *
+ *  Copyright (C) - 2018 - Jimmy Aguilar Mena <kratsbinovish@gmail.com>
+ *                         Guido Giuntoli <gagiuntoli@gmail.com>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <iostream>
+
+#include <iostream>
+#include <iomanip>
+
+#include <ctime>
+#include <cmath>
+#include <cassert>
+
+#include "ell.hpp"
+#include "cholesky.hpp"
+
+using namespace std;
+
+int main (int argc, char *argv[])
+{
+	const int nx = 7;
+	const int ny = 6;
+	const int nz = 5;
+	const int nex = nx - 1;
+	const int ney = ny - 1;
+	const int nez = nz - 1;
+
+	/*
+	 * Laplacian of a trilinear hexahedron, the coefficient only depends
+	 * on the number of different coordinates between the nodes.
+	 */
+	const int xn[8][3] = {
+		{ 0, 0, 0 }, { 1, 0, 0 }, { 1, 1, 0 }, { 0, 1, 0 },
+		{ 0, 0, 1 }, { 1, 0, 1 }, { 1, 1, 1 }, { 0, 1, 1 } };
+	const double coef[4] = { 1. / 3., 0.0, -1. / 12., -1. / 12. };
+
+	double Ae[8 * 8];
+	for (int i = 0; i < 8; ++i) {
+		for (int j = 0; j < 8; ++j) {
+			int diff = 0;
+			for (int d = 0; d < 3; ++d)
+				diff += (xn[i][d] != xn[j][d]);
+			Ae[i * 8 + j] = coef[diff];
+		}
+	}
+
+	ell_matrix A;
+	const int ns[3] = { nx, ny, nz };
+	ell_init(&A, 1, 3, ns);
+
+	ell_solver solver;
+	ell_solver_init(&solver, A.nrow, 1.0e-50, 1.0e-14, 1000);
+
+	ell_set_zero_mat(&A);
+	for (int ex = 0; ex < nex; ++ex)
+		for (int ey = 0; ey < ney; ++ey)
+			for (int ez = 0; ez < nez; ++ez)
+				ell_add_3D(&A, ex, ey, ez, Ae);
+	ell_set_bc_3D(&A);
+
+	chol_matrix L;
+	int ierr = chol_init(&L, &A);
+	assert(ierr == 0);
+	assert(L.n == (nx - 2) * (ny - 2) * (nz - 2));
+
+	cout << "L.n   =\t" << L.n << endl;
+	cout << "L.nnz =\t" << chol_get_nnz(&L) << endl;
+
+	double *b = (double *)calloc(A.nrow, sizeof(double));
+	double *x_cg = (double *)calloc(A.nrow, sizeof(double));
+	double *x_ch = (double *)calloc(A.nrow, sizeof(double));
+	double *r = (double *)calloc(A.nrow, sizeof(double));
+
+	for (int k = 1; k < nz - 1; ++k)
+		for (int j = 1; j < ny - 1; ++j)
+			for (int i = 1; i < nx - 1; ++i)
+				b[nod_index3D(i, j, k)] = sin(i + 2. * j + 3. * k);
+
+	double cg_err;
+	ell_solve_cgpd(&A, &solver, b, x_cg, &cg_err);
+
+	chol_solve(&L, b, x_ch, solver.Ap);
+
+	ell_mvp(&A, x_ch, r);
+	for (int i = 0; i < A.nrow; ++i)
+		r[i] -= b[i];
+
+	cout << "|A x - b| =\t" << get_norm(r, A.nrow) << endl;
+	assert(get_norm(r, A.nrow) < 1.0e-10 * get_norm(b, A.nrow));
+
+	for (int i = 0; i < A.nrow; ++i)
+		assert(fabs(x_ch[i] - x_cg[i]) < 1.0e-8);
+
+	/* With the exact factor as preconditioner CG converges at once */
+	int cg_its = ell_solve_cg_chol(&A, &solver, &L, b, x_cg, &cg_err);
+	cout << "cg_its =\t" << cg_its << endl;
+	assert(cg_its <= 2);
+
+	for (int i = 0; i < A.nrow; ++i)
+		assert(fabs(x_ch[i] - x_cg[i]) < 1.0e-8);
+
+	chol_free(&L);
+	ell_solver_free(&solver);
+	ell_free(&A);
+	free(b);
+	free(x_cg);
+	free(x_ch);
+	free(r);
+
+	return 0;
+}
@@ -49,7 +49,7 @@ int main (int argc, char *argv[])
 	const int ns[3] = { nx, ny, 0 };
 	const int nfield = 1;
 	const int dim = 2;
-	ell_init(&A1, nfield, dim, ns, 1.0e-5, 1.0e-5, 50);
+	ell_init(&A1, nfield, dim, ns);
 
 	cout << "A1.nrow =\t" << A1.nrow << endl;
 	cout << "A1.ncol =\t" << A1.ncol << endl;
@@ -101,7 +101,9 @@ int main (int argc, char *argv[])
 	double *b = (double *)calloc(A1.nrow, sizeof(double));
 	b[4] = 1.0;
 
-	int cg_its = ell_solve_cgpd(&A1, b, x, &cg_err);
+	ell_solver solver;
+	ell_solver_init(&solver, A1.nrow, 1.0e-5, 1.0e-5, 50);
+	int cg_its = ell_solve_cgpd(&A1, &solver, b, x, &cg_err);
 
 	const double x_sol[9] = { 0, 0, 0, 0, 0.0234374, 0, 0, 0, 0 };
 	for (int j = 0; j < 9; ++j)
@@ -110,6 +112,7 @@ int main (int argc, char *argv[])
 	assert (cg_err < 1.0e-10);
 	assert (cg_its == 1);
 
+	ell_solver_free(&solver);
 	ell_free(&A1);
 
 	return 0;
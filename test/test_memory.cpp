@@ -0,0 +1,128 @@
+/*
+ *  This is a test example for MicroPP: a finite element library
+ *  to solve microstructural problems for composite materials.
+ *
+ *  Copyright (C) - 2018 - Jimmy Aguilar Mena <kratsbinovish@gmail.com>
+ *                         Guido Giuntoli <gagiuntoli@gmail.com>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <iostream>
+#include <cassert>
+#include <cstdio>
+
+#include "micropp.hpp"
+
+using namespace std;
+
+/*
+ * Memory accounting : the live peaks stay under the pre-flight estimate,
+ * the temporaries are released and the estimate grows with the threads
+ */
+
+int main (int argc, char *argv[])
+{
+	const int n = 8;
+	micropp_params_t mic_params;
+
+	int coupling[2] = { FE_ONE_WAY, FE_FULL };
+	mic_params.ngp = 2;
+	mic_params.size[0] = n;
+	mic_params.size[1] = n;
+	mic_params.size[2] = n;
+	mic_params.type = MIC_SPHERE;
+	mic_params.coupling = coupling;
+	mic_params.lin_stress = false;
+	mic_params.use_A0 = true;
+	mic_params.use_A0_chol = true;
+	mic_params.output_threads = 1;
+	material_set(&mic_params.materials[0], 1, 1.0e7, 0.3, 1.0e4, 5.0e4, 0.0);
+	material_set(&mic_params.materials[1], 0, 1.0e8, 0.3, 0.0, 0.0, 0.0);
+	material_set(&mic_params.materials[2], 0, 1.0e8, 0.3, 0.0, 0.0, 0.0);
+
+	int nthreads = 1;
+#ifdef _OPENMP
+	nthreads = omp_get_max_threads();
+#endif
+	const micropp_resources_t est = micropp<3>::estimate_resources(mic_params, nthreads);
+	est.print();
+
+	const micropp_resources_t est_4 = micropp<3>::estimate_resources(mic_params, nthreads + 4);
+	assert(est_4.bytes[MEM_WORKSPACES] > est.bytes[MEM_WORKSPACES]);
+	assert(est_4.bytes[MEM_GP_STATE] == est.bytes[MEM_GP_STATE]);
+	assert(est.flops_step > 2 * est.flops_assembly && est.flops_cg_it > 0.0);
+
+	micropp_memory_t usage_0;
+	{
+		micropp<3> micro(mic_params);
+		usage_0 = micro.get_memory_usage();
+		assert(usage_0.current[MEM_MATRICES] > 0);  // A0 and its factor
+		assert(usage_0.current[MEM_OUTPUT] == 0);
+
+		double eps[6] = { 0.0 };
+		for (int t = 0; t < 3; ++t) {
+			eps[0] += 2.0e-3;
+			for (int gp = 0; gp < 2; ++gp)
+				micro.set_strain(gp, eps);
+			micro.homogenize();
+			micro.output(1, "test_memory");
+			micro.write_restart(100 + t);  // not the ids of test_restart_2, the tests can run side by side
+			micro.update_vars();
+		}
+		assert(micro.is_non_linear(0) && micro.is_non_linear(1));
+		micro.output_flush();
+		micro.restart_wait();
+
+		const micropp_memory_t usage = micro.get_memory_usage();
+		usage.print();
+
+		long total = 0;
+		for (int c = 0; c < MEM_NCATS; ++c) {
+			assert(usage.current[c] <= usage.peak[c]);
+			assert(usage.peak[c] <= est.bytes[c]);
+			total += usage.current[c];
+		}
+		assert(usage.current_total == total);
+		assert(usage.peak_total <= est.bytes_total);
+		assert(usage.peak_total >= usage.current_total);
+
+		/* The GP state grew, the temporaries are gone */
+		assert(usage.current[MEM_GP_STATE] > usage_0.current[MEM_GP_STATE]);
+		assert(usage.current[MEM_MATRICES] == usage_0.current[MEM_MATRICES]);
+		assert(usage.current[MEM_WORKSPACES] >= usage_0.current[MEM_WORKSPACES]);  // vars_aux of the threads
+		assert(usage.current[MEM_OUTPUT] < usage.peak[MEM_OUTPUT]);  // the buffers of the writer
+
+		/* The scratch of the GPs is the one of the threads : a new step takes no more memory */
+		eps[0] += 2.0e-3;
+		for (int gp = 0; gp < 2; ++gp)
+			micro.set_strain(gp, eps);
+		micro.homogenize();
+		const micropp_memory_t usage_1 = micro.get_memory_usage();
+		assert(usage_1.current[MEM_MATRICES] == usage.current[MEM_MATRICES]);
+		assert(usage_1.current[MEM_WORKSPACES] == usage.current[MEM_WORKSPACES]);
+		assert(usage_1.peak[MEM_MATRICES] == usage.peak[MEM_MATRICES]);
+		assert(usage_1.peak[MEM_WORKSPACES] == usage.peak[MEM_WORKSPACES]);
+	}
+
+	remove("test_memory.vtu");
+	for (int t = 0; t < 3; ++t) {
+		char name[64];
+		sprintf(name, "micropp-restart-0-%d.bin", 100 + t);
+		remove(name);
+	}
+
+	cout << "test_memory OK" << endl;
+	return 0;
+}
@@ -0,0 +1,115 @@
+/*
+ *  This is a test example for MicroPP: a finite element library
+ *  to solve microstructural problems for composite materials.
+ *
+ *  Copyright (C) - 2018 - Jimmy Aguilar Mena <kratsbinovish@gmail.com>
+ *                         Guido Giuntoli <gagiuntoli@gmail.com>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <iostream>
+#include <cassert>
+#include <cstring>
+
+#include "micropp.hpp"
+
+using namespace std;
+
+/*
+ * NUMA mode : every GP is homogenized once per step by a thread of its
+ * node or stolen by another one, and the results are the ones without it,
+ * also with more threads than at the construction
+ */
+
+#define NGP 12
+#define STEPS 3
+
+static void run(const micropp_params_t &mic_params, const int threads_0, const int threads,
+		double sig[NGP][6], double ctan[NGP][36], long *local, long *remote)
+{
+#ifdef _OPENMP
+	const int max_threads = omp_get_max_threads();
+	omp_set_num_threads(threads_0);
+#endif
+	micropp<3> micro(mic_params);
+#ifdef _OPENMP
+	omp_set_num_threads(threads);
+#endif
+
+	double eps[6] = { 0.0 };
+	for (int t = 0; t < STEPS; ++t) {
+		eps[0] += 5.0e-3;
+		eps[3] += 1.0e-3;
+		for (int gp = 0; gp < NGP; ++gp)
+			micro.set_strain(gp, eps);
+		micro.homogenize();
+		micro.update_vars();
+	}
+	assert(micro.get_non_linear_gps() == NGP);
+
+	for (int gp = 0; gp < NGP; ++gp) {
+		micro.get_stress(gp, sig[gp]);
+		micro.get_ctan(gp, ctan[gp]);
+	}
+	micro.get_numa_counts(local, remote);
+	cout << "numa = " << mic_params.numa << "\tthreads = " << threads_0 << " -> " << threads
+	     << "\tlocal = " << *local << "\tremote = " << *remote << endl;
+#ifdef _OPENMP
+	omp_set_num_threads(max_threads);
+#endif
+}
+
+int main (int argc, char *argv[])
+{
+	const int n = 5;
+	micropp_params_t mic_params;
+
+	mic_params.ngp = NGP;
+	mic_params.size[0] = n;
+	mic_params.size[1] = n;
+	mic_params.size[2] = n;
+	mic_params.type = MIC_SPHERE;
+	mic_params.lin_stress = false;
+	material_set(&mic_params.materials[0], 1, 1.0e7, 0.3, 1.0e4, 5.0e4, 0.0);
+	material_set(&mic_params.materials[1], 0, 1.0e8, 0.3, 0.0, 0.0, 0.0);
+	material_set(&mic_params.materials[2], 0, 1.0e8, 0.3, 0.0, 0.0, 0.0);
+
+	double sig[3][NGP][6], ctan[3][NGP][36];
+	long local[3], remote[3];
+
+	int nthreads = 1;
+#ifdef _OPENMP
+	nthreads = omp_get_max_threads();
+#endif
+	for (int numa = 0; numa < 2; ++numa) {
+		mic_params.numa = numa;
+		run(mic_params, nthreads, nthreads, sig[numa], ctan[numa], &local[numa], &remote[numa]);
+	}
+
+	/* Raised after the construction : the new threads get their node */
+	mic_params.numa = true;
+	run(mic_params, 1, nthreads + 3, sig[2], ctan[2], &local[2], &remote[2]);
+
+	assert(local[0] == 0 && remote[0] == 0);
+	for (int i = 1; i < 3; ++i) {
+		assert(local[i] + remote[i] == STEPS * NGP);
+		assert(local[i] > 0);
+		assert(memcmp(sig[0], sig[i], sizeof(sig[0])) == 0);
+		assert(memcmp(ctan[0], ctan[i], sizeof(ctan[0])) == 0);
+	}
+
+	cout << "test_numa OK" << endl;
+	return 0;
+}
@@ -38,7 +38,7 @@ using namespace std::chrono;
 int main(int argc, char **argv)
 {
 	if (argc < 2) {
-		cerr << "Usage: " << argv[0] << " n [ngp] [steps]" << endl;
+		cerr << "Usage: " << argv[0] << " n [ngp] [steps] [numa=0|1]" << endl;
 		return(1);
 	}
 
@@ -46,6 +46,7 @@ int main(int argc, char **argv)
 	const int n = atoi(argv[1]);
 	const int ngp = (argc > 2 ? atoi(argv[2]) : 2);
 	const int time_steps = (argc > 3 ? atoi(argv[3]) : 1);  // Optional value
+	const int numa = (argc > 4 ? atoi(argv[4]) : 0);  // Optional value
 
 	int dir = 2;
 	double eps[nvoi] = { 0.0 };
@@ -65,6 +66,7 @@ int main(int argc, char **argv)
 	mic_params.calc_ctan_lin = false;
 	mic_params.use_A0 = false;
 	mic_params.lin_stress = false;
+	mic_params.numa = numa;
 
 	mic_params.print();
 
@@ -116,5 +118,9 @@ int main(int argc, char **argv)
 	auto duration = duration_cast<milliseconds>(stop - start);
 	cout << "time = " << duration.count() << " ms" << endl;
 
+	long numa_local, numa_remote;
+	micro.get_numa_counts(&numa_local, &numa_remote);
+	cout << "numa local GPs = " << numa_local << " remote GPs = " << numa_remote << endl;
+
 	return 0;
 }
@@ -0,0 +1,230 @@
+/*
+ *  This is a test example for MicroPP: a finite element library
+ *  to solve microstructural problems for composite materials.
+ *
+ *  Copyright (C) - 2018 - Jimmy Aguilar Mena <kratsbinovish@gmail.com>
+ *                         Guido Giuntoli <gagiuntoli@gmail.com>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <iostream>
+#include <cassert>
+#include <cstdio>
+#include <cstdlib>
+
+#include "micropp.hpp"
+
+using namespace std;
+
+/*
+ * Restart file : a snapshot read back gives the same state and a
+ * corrupted or foreign file is refused without touching the GPs. A
+ * record with a valid CRC but a block of the variables outside of it is
+ * refused too. A chain of a full restart and deltas gives the same state.
+ */
+
+int main (int argc, char *argv[])
+{
+	const int ngp = 3;
+	micropp_params_t mic_params;
+
+	mic_params.ngp = ngp;
+	mic_params.size[0] = 5;
+	mic_params.size[1] = 5;
+	mic_params.size[2] = 5;
+	mic_params.type = MIC_SPHERE;
+	material_set(&mic_params.materials[0], 1, 1.0e7, 0.3, 1.0e4, 5.0e4, 0.0);
+	material_set(&mic_params.materials[1], 0, 1.0e8, 0.3, 0.0, 0.0, 0.0);
+	material_set(&mic_params.materials[2], 0, 1.0e8, 0.3, 0.0, 0.0, 0.0);
+	mic_params.lin_stress = false;
+
+	double eps[6] = { 0.0 }, sig_1[6], sig_2[6];
+
+	micropp<3> *micro = new micropp<3>(mic_params);
+	for (int t = 0; t < 3; ++t) {
+		eps[0] += 5.0e-3;
+		for (int gp = 0; gp < ngp; ++gp)
+			micro->set_strain(gp, eps);
+		micro->homogenize();
+		micro->update_vars();
+	}
+	assert(micro->get_non_linear_gps() == ngp);
+	micro->write_restart(99);
+	micro->restart_wait();
+
+	/* Continuous run */
+	eps[0] += 5.0e-3;
+	micro->set_strain(0, eps);
+	micro->homogenize();
+	micro->get_stress(0, sig_1);
+	delete micro;
+
+	/* Restarted run */
+	micro = new micropp<3>(mic_params);
+	assert(micro->read_restart(99) == 0);
+	assert(micro->get_non_linear_gps() == ngp);
+	micro->set_strain(0, eps);
+	micro->homogenize();
+	micro->get_stress(0, sig_2);
+	for (int i = 0; i < 6; ++i)
+		assert(sig_1[i] == sig_2[i]);
+	delete micro;
+
+	/* A block of the variables past the values of its record, with a valid CRC */
+	FILE *file = fopen("micropp-restart-0-99.bin", "rb");
+	assert(file != NULL);
+	fseek(file, 0, SEEK_END);
+	const long file_bytes = ftell(file);
+	char *data = (char *)malloc(file_bytes);
+	fseek(file, 0, SEEK_SET);
+	assert(fread(data, 1, file_bytes, file) == (size_t)file_bytes);
+	fclose(file);
+
+	restart_entry *entry = (restart_entry *)(data + sizeof(restart_header));
+	char *rec = data + entry->offset;
+	long *off = (long *)(rec + sizeof(char) + 6 * sizeof(double));
+	off[0] = 1L << 40;
+	entry->crc = restart_crc32(rec, entry->bytes);
+
+	file = fopen("micropp-restart-0-98.bin", "wb");
+	assert(file != NULL);
+	fwrite(data, 1, file_bytes, file);
+	fclose(file);
+	free(data);
+
+	micro = new micropp<3>(mic_params);
+	assert(micro->read_restart(98) == 1);
+	delete micro;
+	remove("micropp-restart-0-98.bin");
+
+	/* One flipped byte in the last record */
+	file = fopen("micropp-restart-0-99.bin", "r+b");
+	assert(file != NULL);
+	fseek(file, -10, SEEK_END);
+	int c = fgetc(file);
+	fseek(file, -10, SEEK_END);
+	fputc(c ^ 0x1, file);
+	fclose(file);
+
+	micro = new micropp<3>(mic_params);
+	assert(micro->read_restart(99) == 1);
+	assert(micro->get_non_linear_gps() == 0);
+	delete micro;
+
+	/* Other mesh */
+	mic_params.size[0] = 6;
+	micro = new micropp<3>(mic_params);
+	assert(micro->read_restart(99) == 1);
+	delete micro;
+
+	remove("micropp-restart-0-99.bin");
+
+	/* Full restart 1, deltas 2 and 3 with only GP 0 changing */
+	mic_params.size[0] = 5;
+	mic_params.restart_full_every = 3;
+	eps[0] = 0.0;
+	micro = new micropp<3>(mic_params);
+	for (int t = 0; t < 5; ++t) {
+		eps[0] += 5.0e-3;
+		for (int gp = 0; gp < ((t < 3) ? ngp : 1); ++gp)
+			micro->set_strain(gp, eps);
+		micro->homogenize();
+		micro->update_vars();
+		if (t >= 2)
+			micro->write_restart(t - 1);
+	}
+	micro->restart_wait();
+
+	long bytes[3];
+	for (int r = 0; r < 3; ++r) {
+		char name[64];
+		sprintf(name, "micropp-restart-0-%d.bin", r + 1);
+		file = fopen(name, "rb");
+		assert(file != NULL);
+		fseek(file, 0, SEEK_END);
+		bytes[r] = ftell(file);
+		fclose(file);
+	}
+	assert(bytes[1] < bytes[0] / 2 && bytes[2] < bytes[0] / 2);
+
+	eps[0] += 5.0e-3;
+	micro->set_strain(0, eps);
+	micro->homogenize();
+	micro->get_stress(0, sig_1);
+	delete micro;
+
+	micro = new micropp<3>(mic_params);
+	assert(micro->read_restart(3) == 0);
+	assert(micro->get_non_linear_gps() == ngp);
+	micro->set_strain(0, eps);
+	micro->homogenize();
+	micro->get_stress(0, sig_2);
+	for (int i = 0; i < 6; ++i)
+		assert(sig_1[i] == sig_2[i]);
+	delete micro;
+
+	/* Without its full restart a delta is refused */
+	remove("micropp-restart-0-1.bin");
+	micro = new micropp<3>(mic_params);
+	assert(micro->read_restart(3) == 1);
+	assert(micro->get_non_linear_gps() == 0);
+	delete micro;
+
+	remove("micropp-restart-0-2.bin");
+	remove("micropp-restart-0-3.bin");
+
+	/* Two files used in turn : a delta never overwrites a file of its chain */
+	for (int nw = 3; nw <= 4; ++nw) {
+		eps[0] = 0.0;
+		micro = new micropp<3>(mic_params);
+		for (int t = 0; t < nw; ++t) {
+			eps[0] += 5.0e-3;
+			for (int gp = 0; gp < ((t < 2) ? ngp : 1); ++gp)
+				micro->set_strain(gp, eps);
+			micro->homogenize();
+			micro->update_vars();
+			micro->write_restart(10 + t % 2);
+		}
+		micro->restart_wait();
+
+		eps[0] += 5.0e-3;
+		micro->set_strain(0, eps);
+		micro->homogenize();
+		micro->get_stress(0, sig_1);
+		delete micro;
+
+		micro = new micropp<3>(mic_params);
+		assert(micro->read_restart(10 + (nw - 1) % 2) == 0);
+		micro->set_strain(0, eps);
+		micro->homogenize();
+		micro->get_stress(0, sig_2);
+		for (int i = 0; i < 6; ++i)
+			assert(sig_1[i] == sig_2[i]);
+		delete micro;
+
+		/* With 3 the delta 11 relied on the restart 10 rewritten after it */
+		if (nw == 3) {
+			micro = new micropp<3>(mic_params);
+			assert(micro->read_restart(11) == 1);
+			assert(micro->get_non_linear_gps() == 0);
+			delete micro;
+		}
+	}
+
+	remove("micropp-restart-0-10.bin");
+	remove("micropp-restart-0-11.bin");
+
+	return 0;
+}
@@ -0,0 +1,98 @@
+/*
+ *  This is a test example for MicroPP: a finite element library
+ *  to solve microstructural problems for composite materials.
+ *
+ *  Copyright (C) - 2018 - Jimmy Aguilar Mena <kratsbinovish@gmail.com>
+ *                         Guido Giuntoli <gagiuntoli@gmail.com>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <iostream>
+#include <cassert>
+#include <cstdint>
+
+#include "slab.hpp"
+#include "vars.hpp"
+
+using namespace std;
+
+int main (int argc, char *argv[])
+{
+	slab_t s;
+	int ierr = slab_init(&s, 4096);
+	assert(ierr == 0);
+
+	/* Aligned blocks, bumped inside the same chunk */
+	char *p1 = (char *)slab_alloc(&s, 100);
+	char *p2 = (char *)slab_alloc(&s, 100);
+	assert((uintptr_t)p1 % SLAB_ALIGN == 0);
+	assert((uintptr_t)p2 % SLAB_ALIGN == 0);
+	assert(p2 - p1 == 128);
+	assert(s.nchunks == 1);
+
+	/* A block larger than the chunk size gets its own chunk */
+	char *p3 = (char *)slab_alloc(&s, 10000);
+	assert(p3 != NULL && (uintptr_t)p3 % SLAB_ALIGN == 0);
+	assert(s.nchunks == 2);
+	assert(slab_get_bytes(&s) == 4096 + 10048);
+
+	/* Many chunks */
+	for (int i = 0; i < 100; ++i)
+		assert(slab_alloc(&s, 3000) != NULL);
+	assert(s.nchunks == 102);
+
+	/* Variables on the slab : growth keeps the values */
+	const int nelem = 500;
+	const int npe = 8;
+	const int nvar = 7;
+
+	vars_map m;
+	vars_init(&m, nelem, npe, &s);
+	for (int e = 0; e < nelem; e += 2) {
+		double *blk = vars_add(&m, e, nvar);
+		for (int i = 0; i < npe * nvar; ++i)
+			blk[i] = e * 1000 + i;
+	}
+	for (int e = 0; e < nelem; e += 2)
+		assert(vars_get(&m, e, 7, nvar)[6] == e * 1000 + 7 * nvar + 6);
+
+	vars_map c;
+	vars_init(&c, nelem, npe, &s);
+	vars_copy(&c, &m);
+	assert(vars_get(&c, 498, 0, nvar)[0] == 498 * 1000);
+
+	cout << "slab [B] : " << slab_get_bytes(&s) << endl;
+
+	vars_free(&m);
+	vars_free(&c);
+	slab_free(&s);
+	assert(s.nchunks == 0 && slab_get_bytes(&s) == 0);
+
+	/* Slab on files : the blocks written back are read again intact */
+	slab_t f;
+	ierr = slab_init(&f, 1 << 20, "/tmp");
+	assert(ierr == 0);
+	double *a = (double *)slab_alloc(&f, 100000 * sizeof(double));
+	assert(a != NULL && f.fds[0] >= 0);
+	for (int i = 0; i < 100000; ++i)
+		a[i] = i;
+	slab_evict(&f, a, 100000 * sizeof(double));
+	slab_prefetch(&f, a, 100000 * sizeof(double));
+	for (int i = 0; i < 100000; ++i)
+		assert(a[i] == i);
+	slab_free(&f);
+
+	return 0;
+}
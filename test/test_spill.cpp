@@ -0,0 +1,100 @@
+/*
+ *  This is a test example for MicroPP: a finite element library
+ *  to solve microstructural problems for composite materials.
+ *
+ *  Copyright (C) - 2018 - Jimmy Aguilar Mena <kratsbinovish@gmail.com>
+ *                         Guido Giuntoli <gagiuntoli@gmail.com>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <iostream>
+#include <cassert>
+#include <cstring>
+
+#include "micropp.hpp"
+
+using namespace std;
+
+/*
+ * Out-of-core GP state : with a spill_mem budget well under the state of
+ * the GPs they are written back to the spill files and read again, the
+ * results are the ones of the run in memory
+ */
+
+#define NGP 16
+#define STEPS 3
+
+class test_t : public micropp<3> {
+
+	public:
+		test_t(const micropp_params_t &mic_params) : micropp<3>(mic_params) {};
+
+		long get_spill_outs() const { return spill_outs; }
+		long get_spill_resident() const { return spill_resident; }
+		long get_spill_budget() const { return spill_budget; }
+};
+
+int main (int argc, char *argv[])
+{
+	const int n = 8;
+	micropp_params_t mic_params;
+
+	mic_params.ngp = NGP;
+	mic_params.size[0] = n;
+	mic_params.size[1] = n;
+	mic_params.size[2] = n;
+	mic_params.type = MIC_SPHERE;
+	mic_params.lin_stress = false;
+	mic_params.spill_dir = ".";
+	material_set(&mic_params.materials[0], 1, 1.0e7, 0.3, 1.0e4, 5.0e4, 0.0);
+	material_set(&mic_params.materials[1], 0, 1.0e8, 0.3, 0.0, 0.0, 0.0);
+	material_set(&mic_params.materials[2], 0, 1.0e8, 0.3, 0.0, 0.0, 0.0);
+
+	double sig[2][NGP][6], ctan[2][NGP][36];
+	long outs[2];
+
+	for (int spill = 0; spill < 2; ++spill) {
+		mic_params.spill_mem = spill;  // 1 MB
+		test_t micro(mic_params);
+
+		double eps[6] = { 0.0 };
+		for (int t = 0; t < STEPS; ++t) {
+			eps[0] += 5.0e-3;
+			eps[3] += 1.0e-3;
+			for (int gp = 0; gp < NGP; ++gp)
+				micro.set_strain(gp, eps);
+			micro.homogenize();
+			micro.update_vars();
+			assert(micro.get_spill_resident() <= micro.get_spill_budget());
+		}
+		assert(micro.get_non_linear_gps() == NGP);
+
+		for (int gp = 0; gp < NGP; ++gp) {
+			micro.get_stress(gp, sig[spill][gp]);
+			micro.get_ctan(gp, ctan[spill][gp]);
+		}
+		outs[spill] = micro.get_spill_outs();
+		cout << "spill_mem = " << spill << "\tspilled GPs = " << outs[spill] << endl;
+	}
+
+	assert(outs[0] == 0);
+	assert(outs[1] > NGP);  // more than one round of write backs
+
+	assert(memcmp(sig[0], sig[1], sizeof(sig[0])) == 0);
+	assert(memcmp(ctan[0], ctan[1], sizeof(ctan[0])) == 0);
+
+	cout << "test_spill OK" << endl;
+	return 0;
+}
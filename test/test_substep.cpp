@@ -0,0 +1,97 @@
+/*
+ *  This is a test example for MicroPP: a finite element library
+ *  to solve microstructural problems for composite materials.
+ *
+ *  Copyright (C) - 2018 - Jimmy Aguilar Mena <kratsbinovish@gmail.com>
+ *                         Guido Giuntoli <gagiuntoli@gmail.com>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <iostream>
+#include <cassert>
+#include <cstdlib>
+#include <cstring>
+
+#include "micropp.hpp"
+
+using namespace std;
+
+/*
+ * Sub-stepping : with the halvings spent and Newton failing every time
+ * each sub-step is accepted with 1 / nsubiterations of the strain step,
+ * so the step is split in exactly nsubiterations sub-steps.
+ */
+
+class test_t : public micropp<3> {
+
+	public:
+		test_t(const micropp_params_t &mic_params) : micropp<3>(mic_params) {};
+
+		int substeps(const double eps[6])
+		{
+			const int ns[3] = { nx, ny, nz };
+			gp_t<3> *gp_ptr = &gp_list[0];
+
+			ell_matrix A;
+			ell_init(&A, dim, dim, ns);
+			double *b = (double *)calloc(nndim, sizeof(double));
+			double *u = (double *)calloc(nndim, sizeof(double));
+			double *du = (double *)calloc(nndim, sizeof(double));
+
+			memcpy(gp_ptr->strain, eps, nvoi * sizeof(double));
+			gp_ptr->substeps = 0;
+			gp_ptr->substep_cuts = SUBSTEP_MAX_CUTS;
+			newton_substepping(gp_ptr, &A, b, u, du, false);
+
+			ell_free(&A);
+			free(b);
+			free(u);
+			free(du);
+			return gp_ptr->substeps;
+		}
+};
+
+int main (int argc, char *argv[])
+{
+	const int n = 5;
+	micropp_params_t mic_params;
+
+	mic_params.ngp = 1;
+	mic_params.size[0] = n;
+	mic_params.size[1] = n;
+	mic_params.size[2] = n;
+	mic_params.type = MIC_SPHERE;
+	mic_params.lin_stress = false;
+	mic_params.subiterations = true;
+	mic_params.nr_max_its = 1;
+	mic_params.nr_max_tol = 1.0e-30;
+	material_set(&mic_params.materials[0], 1, 1.0e7, 0.3, 1.0e4, 5.0e4, 0.0);
+	material_set(&mic_params.materials[1], 0, 1.0e8, 0.3, 0.0, 0.0, 0.0);
+	material_set(&mic_params.materials[2], 0, 1.0e8, 0.3, 0.0, 0.0, 0.0);
+
+	const double eps[6] = { 1.0e-2, 0.0, 0.0, 2.0e-3, 0.0, 0.0 };
+	const int nsubs[4] = { 3, 7, 10, 25 };
+
+	for (int i = 0; i < 4; ++i) {
+		mic_params.nsubiterations = nsubs[i];
+		test_t micro(mic_params);
+		const int substeps = micro.substeps(eps);
+		cout << "nsubiterations = " << nsubs[i] << "\tsubsteps = " << substeps << endl;
+		assert(substeps == nsubs[i]);
+	}
+
+	cout << "test_substep OK" << endl;
+	return 0;
+}
@@ -0,0 +1,100 @@
+/*
+ *  This is a test example for MicroPP: a finite element library
+ *  to solve microstructural problems for composite materials.
+ *
+ *  Copyright (C) - 2018 - Jimmy Aguilar Mena <kratsbinovish@gmail.com>
+ *                         Guido Giuntoli <gagiuntoli@gmail.com>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <iostream>
+#include <cassert>
+#include <cstdio>
+#include <fstream>
+#include <string>
+
+#include "micropp.hpp"
+
+using namespace std;
+
+/*
+ * Telemetry of the Newton solves of each GP and the CSV / binary logs
+ */
+
+#define STEPS 3
+
+int main (int argc, char *argv[])
+{
+	const int n = 6;
+	micropp_params_t mic_params;
+
+	int coupling[2] = { FE_ONE_WAY, FE_FULL };
+	mic_params.ngp = 2;
+	mic_params.size[0] = n;
+	mic_params.size[1] = n;
+	mic_params.size[2] = n;
+	mic_params.type = MIC_SPHERE;
+	mic_params.coupling = coupling;
+	mic_params.lin_stress = false;
+	material_set(&mic_params.materials[0], 1, 1.0e7, 0.3, 1.0e4, 5.0e4, 0.0);
+	material_set(&mic_params.materials[1], 0, 1.0e8, 0.3, 0.0, 0.0, 0.0);
+	material_set(&mic_params.materials[2], 0, 1.0e8, 0.3, 0.0, 0.0, 0.0);
+
+	remove("micropp-telemetry-0.csv");
+	remove("micropp-telemetry-0.bin");
+
+	for (int log = TELEM_LOG_CSV; log <= TELEM_LOG_BINARY; ++log) {
+		mic_params.telemetry_log = log;
+		micropp<3> micro(mic_params);
+
+		double eps[6] = { 0.0 };
+		for (int t = 0; t < STEPS; ++t) {
+			eps[0] += 2.0e-3;
+			for (int gp = 0; gp < 2; ++gp)
+				micro.set_strain(gp, eps);
+			micro.homogenize();
+
+			for (int gp = 0; gp < 2; ++gp) {
+				const gp_telemetry *telem = micro.get_telemetry(gp);
+				assert(telem->newton_its > 0);
+				assert(telem->solver_its == micro.get_cost(gp));
+				assert(telem->nsolves == telem->newton_its);
+				assert(telem->nresiduals > 0);
+				assert(telem->residuals[telem->nresiduals - 1] < telem->residuals[0]);
+				assert(telem->converged == micro.has_converged(gp));
+				assert(telem->bytes > 0);
+				assert(telem->t_assembly > 0.0 && telem->t_solve > 0.0);
+				assert(telem->t_assembly + telem->t_solve + telem->t_material <= telem->t_total);
+			}
+			/* The non-linear tangent of FE_FULL needs 6 more solves */
+			if (micro.is_non_linear(1))
+				assert(micro.get_telemetry(1)->nsolves > micro.get_telemetry(0)->nsolves);
+			micro.update_vars();
+		}
+	}
+
+	ifstream csv("micropp-telemetry-0.csv");
+	string line;
+	int lines = 0;
+	while (getline(csv, line))
+		lines++;
+	assert(lines == 1 + STEPS * 2);
+
+	ifstream bin("micropp-telemetry-0.bin", ios::in | ios::binary | ios::ate);
+	assert((long)bin.tellg() == STEPS * 2 * (2 * sizeof(int) + sizeof(gp_telemetry)));
+
+	cout << "test_telemetry OK" << endl;
+	return 0;
+}
@@ -0,0 +1,85 @@
+/*
+ *  This is a test example for MicroPP: a finite element library
+ *  to solve microstructural problems for composite materials.
+ *
+ *  Copyright (C) - 2018 - Jimmy Aguilar Mena <kratsbinovish@gmail.com>
+ *                         Guido Giuntoli <gagiuntoli@gmail.com>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <iostream>
+#include <cassert>
+
+#include "vars.hpp"
+
+using namespace std;
+
+int main (int argc, char *argv[])
+{
+	const int nelem = 1000;
+	const int npe = 8;
+	const int nvar = 7;
+
+	vars_map m;
+	int ierr = vars_init(&m, nelem, npe);
+	assert(ierr == 0);
+
+	/* Elements without block read implicit zeros */
+	for (int e = 0; e < nelem; ++e)
+		assert(vars_get(&m, e, 3, nvar) == nullptr);
+	assert(vars_get(nullptr, 0, 0, nvar) == nullptr);
+
+	/* Every 10th element gets a block, forcing the growth of <vals> */
+	for (int e = 0; e < nelem; e += 10) {
+		double *blk = vars_add(&m, e, nvar);
+		for (int i = 0; i < npe * nvar; ++i)
+			blk[i] = e * 1000 + i;
+	}
+	assert(m.nactive == nelem / 10);
+	assert(m.size == (long)(nelem / 10) * npe * nvar);
+	assert(vars_add(&m, 20, nvar) == vars_get(&m, 20, 0, nvar));
+	assert(m.nactive == nelem / 10);
+
+	for (int e = 0; e < nelem; ++e) {
+		for (int gp = 0; gp < npe; ++gp) {
+			const double *vars = vars_get(&m, e, gp, nvar);
+			if (e % 10) {
+				assert(vars == nullptr);
+			} else {
+				for (int v = 0; v < nvar; ++v)
+					assert(vars[v] == e * 1000 + gp * nvar + v);
+			}
+		}
+	}
+
+	vars_map c;
+	vars_init(&c, nelem, npe);
+	vars_copy(&c, &m);
+	assert(c.nactive == m.nactive);
+	assert(vars_get(&c, 990, 7, nvar)[6] == 990 * 1000 + 7 * nvar + 6);
+
+	/* Sparse storage : about 1/10 of the dense one plus the offsets */
+	cout << "dense  [B] : " << (long)nelem * npe * nvar * sizeof(double) << endl;
+	cout << "sparse [B] : " << vars_get_bytes(&m) << endl;
+
+	vars_clear(&m);
+	assert(m.nactive == 0 && m.size == 0);
+	assert(vars_get(&m, 990, 0, nvar) == nullptr);
+
+	vars_free(&m);
+	vars_free(&c);
+
+	return 0;
+}
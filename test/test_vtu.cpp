@@ -0,0 +1,184 @@
+/*
+ *  This is a test example for MicroPP: a finite element library
+ *  to solve microstructural problems for composite materials.
+ *
+ *  Copyright (C) - 2018 - Jimmy Aguilar Mena <kratsbinovish@gmail.com>
+ *                         Guido Giuntoli <gagiuntoli@gmail.com>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <iostream>
+#include <cassert>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+#ifdef _ZLIB
+#include <zlib.h>
+#endif
+
+#include "micropp.hpp"
+
+using namespace std;
+
+/*
+ * VTU files : the appended data of the binary formats has the same
+ * values as the mesh, raw or compressed. The VTI files have no mesh.
+ * The background writers give the same files.
+ */
+
+static string read_file(const char *name)
+{
+	ifstream file(name, ios::in | ios::binary);
+	assert(file.good());
+	stringstream ss;
+	ss << file.rdbuf();
+	return ss.str();
+}
+
+/* offset of the appended DataArray <name> */
+static long offset_of(const string &file, const char *name)
+{
+	const size_t tag = file.find(string("Name=\"") + name + "\"");
+	const size_t pos = file.find("offset=\"", tag) + strlen("offset=\"");
+	return atol(file.c_str() + pos);
+}
+
+int main (int argc, char *argv[])
+{
+	const int n = 5;
+	const int nn = n * n * n;
+	const double d = 1.0 / (n - 1);
+	micropp_params_t mic_params;
+
+	mic_params.ngp = 1;
+	mic_params.size[0] = n;
+	mic_params.size[1] = n;
+	mic_params.size[2] = n;
+	mic_params.type = MIC_SPHERE;
+	material_set(&mic_params.materials[0], 0, 1.0e7, 0.3, 0.0, 0.0, 0.0);
+	material_set(&mic_params.materials[1], 0, 1.0e8, 0.3, 0.0, 0.0, 0.0);
+	material_set(&mic_params.materials[2], 0, 1.0e8, 0.3, 0.0, 0.0, 0.0);
+
+	const double eps[6] = { 1.0e-3, 0.0, 0.0, 0.0, 0.0, 0.0 };
+	const char *names[3] = { "test_vtu_ascii", "test_vtu_raw", "test_vtu_zlib" };
+
+	for (int format = VTU_ASCII; format <= VTU_ZLIB; ++format) {
+		mic_params.vtu_format = format;
+		micropp<3> micro(mic_params);
+		micro.set_strain(0, eps);
+		micro.homogenize();
+		micro.output(0, names[format]);
+	}
+
+	const string ascii = read_file("test_vtu_ascii.vtu");
+	const string raw = read_file("test_vtu_raw.vtu");
+	const string zlib = read_file("test_vtu_zlib.vtu");
+	assert(ascii.find("format=\"ascii\"") != string::npos);
+	assert(raw.size() < ascii.size());
+
+	/* Position is the first block */
+	const string tag = "<AppendedData encoding=\"raw\">\n_";
+	const size_t start = raw.find(tag) + tag.size();
+	uint64_t bytes;
+	memcpy(&bytes, &raw[start], sizeof(uint64_t));
+	assert(bytes == nn * 3 * sizeof(double));
+
+	/* The next block starts after the one of Position */
+	assert(raw.find("Name=\"connectivity\"") != string::npos);
+	assert(offset_of(raw, "connectivity") == (long)(sizeof(uint64_t) + bytes));
+
+	const double *coor = (const double *)&raw[start + sizeof(uint64_t)];
+	for (int k = 0; k < n; ++k)
+		for (int j = 0; j < n; ++j)
+			for (int i = 0; i < n; ++i) {
+				const int node = (k * n + j) * n + i;
+				assert(coor[node * 3 + 0] == i * d);
+				assert(coor[node * 3 + 1] == j * d);
+				assert(coor[node * 3 + 2] == k * d);
+			}
+
+#ifdef _ZLIB
+	assert(zlib.find("vtkZLibDataCompressor") != string::npos);
+	const size_t zstart = zlib.find(tag) + tag.size();
+	uint64_t header[4];
+	memcpy(header, &zlib[zstart], 4 * sizeof(uint64_t));
+	assert(header[0] == 1 && header[2] == bytes);
+
+	uLongf dst_bytes = bytes;
+	char *dst = new char[bytes];
+	assert(uncompress((Bytef *)dst, &dst_bytes, (const Bytef *)&zlib[zstart + 4 * sizeof(uint64_t)],
+			  header[3]) == Z_OK);
+	assert(dst_bytes == bytes);
+	assert(memcmp(dst, coor, bytes) == 0);
+	delete [] dst;
+	assert(offset_of(zlib, "Position") == 0);
+	assert(offset_of(zlib, "connectivity") == (long)(4 * sizeof(uint64_t) + header[3]));
+#endif
+
+	/* ImageData : the same arrays without points and cells */
+	mic_params.vtu_format = VTU_RAW;
+	mic_params.vti_output = true;
+	{
+		micropp<3> micro(mic_params);
+		micro.set_strain(0, eps);
+		micro.homogenize();
+		micro.output(0, "test_vtu_image");
+	}
+	const string image = read_file("test_vtu_image.vti");
+	assert(image.find("WholeExtent=\"0 4 0 4 0 4\"") != string::npos);
+	assert(image.find("Name=\"Position\"") == string::npos);
+	assert(image.find("Name=\"stress\"") != string::npos);
+	assert(image.size() < raw.size());
+
+	/* Background writers : the same files as written in place, and the .vtm of the step */
+	mic_params.ngp = 3;
+	mic_params.vti_output = false;
+	string sync[3];
+	for (int threads = 0; threads <= 2; threads += 2) {
+		mic_params.output_threads = threads;
+		mic_params.output_vtm = (threads > 0);
+		micropp<3> micro(mic_params);
+		for (int gp = 0; gp < 3; ++gp) {
+			const double eps_gp[6] = { 1.0e-3 * (gp + 1), 0.0, 0.0, 0.0, 0.0, 0.0 };
+			micro.set_strain(gp, eps_gp);
+		}
+		micro.homogenize();
+		for (int gp = 0; gp < 3; ++gp)
+			micro.output2(gp, 10 + gp, 7);
+		micro.output_flush();
+		for (int gp = 0; gp < 3; ++gp) {
+			char name[64];
+			sprintf(name, "micropp-%d-7.vtu", 10 + gp);
+			if (threads == 0)
+				sync[gp] = read_file(name);
+			else
+				assert(read_file(name) == sync[gp]);
+			remove(name);
+		}
+	}
+	const string vtm = read_file("micropp-step-0-7.vtm");
+	assert(vtm.find("file=\"micropp-12-7.vtu\"") != string::npos);
+	remove("micropp-step-0-7.vtm");
+
+	for (int format = VTU_ASCII; format <= VTU_ZLIB; ++format)
+		remove((string(names[format]) + ".vtu").c_str());
+	remove("test_vtu_image.vti");
+
+	return 0;
+}